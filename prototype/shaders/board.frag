@@ -97,7 +97,7 @@ void main(void)
 
 	vec3 marker_color = MARKER_COLOR;
 
-	vec3 normal = texture(NORMALMAP, fragment.texcoord).rgb;
+	vec3 normal = normalize(texture(NORMALMAP, fragment.texcoord).rgb * 2.0 - 1.0);
 
 	float slope = 1.0 - normal.y;
 	slope = smoothstep(0.3, 0.7, slope);
@@ -19,7 +19,7 @@ void main(void)
 
 	fcolor.rgb = mix(fcolor.rgb, vec3(0.5, 0.5, 0.5), 0.25);
 
-	vec3 normal = texture(NORMALMAP, fragment.texcoord).rgb;
+	vec3 normal = normalize(texture(NORMALMAP, fragment.texcoord).rgb * 2.0 - 1.0);
 
 	// terrain lighting
 	const vec3 light_color = vec3(1.0, 1.0, 1.0);
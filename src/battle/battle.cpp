@@ -26,6 +26,7 @@
 #include "../util/timer.h"
 #include "../util/navigation.h"
 #include "../util/image.h"
+#include "../util/heightpyramid.h"
 #include "../util/animation.h"
 #include "../graphics/shader.h"
 #include "../graphics/mesh.h"
@@ -420,12 +421,7 @@ void Battle::display()
 
 float Battle::vertical_offset(float x, float z)
 {
-	glm::vec3 origin = { x, 2.F * SCENE_BOUNDS.max.y, z };
-	glm::vec3 end = { x, 0.F, z };
-
-	auto result = physics.cast_ray(origin, end);
-	
-	return result.point.y;
+	return terrain->height_pyramid().height_at(glm::vec2(x, z));
 }
 	
 void Battle::update_debug_menu()
@@ -644,7 +640,7 @@ void Battle::build_navigation()
 			glm::vec2 relative_position = { i / float(nav_res), j / float(nav_res) };
 			glm::vec2 real_position = (relative_position * area_size) + PLAYABLE_AREA.min;
 			glm::vec2 image_position = { real_position.x / scale.x, real_position.y / scale.z };
-			float height = heightmap.sample_relative(image_position.x, image_position.y, util::CHANNEL_RED);
+			float height = heightmap.sample_bilinear(image_position.x, image_position.y, util::CHANNEL_RED);
 			vertices.push_back(real_position.x);
 			vertices.push_back(scale.y * height);
 			vertices.push_back(real_position.y);
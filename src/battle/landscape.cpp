@@ -214,8 +214,8 @@ void Landscaper::fill_wall(const geom::Segment &segment, const util::Image<float
 	glm::vec2 origin = segment.A;
 	float d = (1.f / WALL_SEG_DIST) * glm::distance(segment.A, segment.B);
 	// find height of the end positions of the segment on the heightmap
-	float h0 = heightmap.sample_relative(segment.A.x / scale.x, segment.A.y / scale.y, util::CHANNEL_RED);
-	float h1 = heightmap.sample_relative(segment.B.x / scale.x, segment.B.y / scale.y, util::CHANNEL_RED);
+	float h0 = heightmap.sample_bilinear(segment.A.x / scale.x, segment.A.y / scale.y, util::CHANNEL_RED);
+	float h1 = heightmap.sample_bilinear(segment.B.x / scale.x, segment.B.y / scale.y, util::CHANNEL_RED);
 
 	glm::vec2 position = origin;
 	// if the end positions differ too much in height use wall segments with stairs
@@ -244,9 +244,9 @@ void Landscaper::fill_wall(const geom::Segment &segment, const util::Image<float
 				// otherwise check the height difference and pick a wall based on that
 				glm::vec2 left_pos = origin - offset;
 				glm::vec2 right_pos = origin + offset;
-				float left_height = heightmap.sample_relative(left_pos.x / scale.x, left_pos.y / scale.y, util::CHANNEL_RED);
-				float right_height = heightmap.sample_relative(right_pos.x / scale.x, right_pos.y / scale.y, util::CHANNEL_RED);
-				float height = heightmap.sample_relative(origin.x / scale.x, origin.y / scale.y, util::CHANNEL_RED);
+				float left_height = heightmap.sample_bilinear(left_pos.x / scale.x, left_pos.y / scale.y, util::CHANNEL_RED);
+				float right_height = heightmap.sample_bilinear(right_pos.x / scale.x, right_pos.y / scale.y, util::CHANNEL_RED);
+				float height = heightmap.sample_bilinear(origin.x / scale.x, origin.y / scale.y, util::CHANNEL_RED);
 				if (left_height < height && right_height < height) {
 					output.wall_both.transforms.push_back(transform);
 				} else if (left_height < height) {
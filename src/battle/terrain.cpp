@@ -16,6 +16,9 @@
 #include "../geometry/transform.h"
 #include "../util/camera.h"
 #include "../util/image.h"
+#include "../util/heightpyramid.h"
+#include "../util/noise.h"
+#include "../util/normalmap.h"
 #include "../graphics/shader.h"
 #include "../graphics/mesh.h"
 #include "../graphics/texture.h"
@@ -42,6 +45,7 @@ Terrain::Terrain(std::shared_ptr<gfx::Shader> shader, const geom::AABB &bounds)
 	m_normal_texture.create(m_normalmap);
 	
 	m_height_field = std::make_unique<fysx::HeightField>(m_heightmap, m_scale);
+	m_height_pyramid.build(m_heightmap, util::CHANNEL_RED, m_scale);
 
 	add_material("DISPLACEMENT", &m_texture);
 	add_material("NORMALMAP", &m_normal_texture);
@@ -59,18 +63,12 @@ void Terrain::generate(int seed)
 	fastnoise.SetPerturbFrequency(0.001f);
 	fastnoise.SetGradientPerturbAmp(20.f);
 
-	#pragma omp parallel for
-	for (int i = 0; i < m_heightmap.width(); i++) {
-		for (int j = 0; j < m_heightmap.height(); j++) {
-			float x = i; float y = j;
-			fastnoise.GradientPerturbFractal(x, y);
-			float height = 0.5f * (fastnoise.GetNoise(x, y) + 1.f);
-			m_heightmap.plot(i, j, util::CHANNEL_RED, 0.8f * height);
-		}
-	}
+	util::noise_image(m_heightmap, &fastnoise, glm::vec2(1.f), util::CHANNEL_RED, 0.8f);
 
 	create_normalmap();
 
+	m_height_pyramid.build(m_heightmap, util::CHANNEL_RED, m_scale);
+
 	// store heightmap in texture
 	m_texture.reload(m_heightmap);
 
@@ -120,15 +118,5 @@ void Terrain::bind_textures() const
 	
 void Terrain::create_normalmap()
 {
-	float strength = 32.f;
-
-	#pragma omp parallel for
-	for (int x = 0; x < m_heightmap.width(); x++) {
-		for (int y = 0; y < m_heightmap.height(); y++) {
-			const glm::vec3 normal = util::filter_normal(x, y, util::CHANNEL_RED, strength, m_heightmap);
-			m_normalmap.plot(x, y, util::CHANNEL_RED, normal.x);
-			m_normalmap.plot(x, y, util::CHANNEL_GREEN, normal.y);
-			m_normalmap.plot(x, y, util::CHANNEL_BLUE, normal.z);
-		}
-	}
+	util::normal_map(m_heightmap, util::CHANNEL_RED, 32.f, m_normalmap);
 }
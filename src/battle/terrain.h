@@ -7,6 +7,7 @@ public:
 	void display(const util::Camera &camera) const;
 	void add_material(const std::string &name, const gfx::Texture *texture);
 	const util::Image<float>& heightmap() const;
+	const util::HeightPyramid& height_pyramid() const { return m_height_pyramid; }
 public:
 	fysx::HeightField* height_field();
 private:
@@ -17,8 +18,9 @@ private:
 	std::unordered_map<std::string, const gfx::Texture*> m_materials;
 	glm::vec3 m_scale = {};
 	util::Image<float> m_heightmap;
-	util::Image<float> m_normalmap;
+	util::Image<uint8_t> m_normalmap;
 	std::unique_ptr<fysx::HeightField> m_height_field;
+	util::HeightPyramid m_height_pyramid;
 private:
 	void create_normalmap();
 	void bind_textures() const;
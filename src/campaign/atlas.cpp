@@ -1,10 +1,9 @@
 #include <vector>
+#include <string>
 #include <random>
 #include <memory>
 #include <queue>
-#include <list>
-#include <chrono>
-#include <unordered_map>
+#include <functional>
 #include <glm/vec3.hpp>
 #include <glm/vec4.hpp>
 #include <glm/mat4x4.hpp>
@@ -12,67 +11,30 @@
 
 #include "../extern/fastnoise/FastNoise.h"
 
-#include "../extern/poisson/PoissonGenerator.h"
-
 #include "../geometry/geometry.h"
 #include "../geometry/voronoi.h"
+#include "../geometry/poisson.h"
 #include "../geometry/transform.h"
 #include "../util/image.h"
+#include "../util/tiledimage.h"
 #include "../util/noise.h"
 #include "../util/erode.h"
+#include "../util/normalmap.h"
+#include "../util/taskgraph.h"
 
 #include "atlas.h"
 	
-static RiverBranch *create_branch(const Corner *confluence)
-{
-	RiverBranch *node = new RiverBranch;
-	node->confluence = confluence;
-	node->left = nullptr;
-	node->right = nullptr;
-	node->streamorder = 1;
-
-	return node;
-}
-
-static void prune_branches(RiverBranch *root)
-{
-	if (root == nullptr) { return; }
-
-	std::queue<RiverBranch*> queue;
-	queue.push(root);
-
-	while (!queue.empty()) {
-		RiverBranch *front = queue.front();
-		queue.pop();
-		if (front->left) { queue.push(front->left); }
-		if (front->right) { queue.push(front->right); }
-
-		delete front;
-	}
-
-	root = nullptr;
-}
-
-static void delete_basin(DrainageBasin *tree)
-{
-	if (tree->mouth == nullptr) { return; }
-
-	prune_branches(tree->mouth);
-
-	tree->mouth = nullptr;
-}
-
 // Strahler stream order
 // https://en.wikipedia.org/wiki/Strahler_number
-static inline int strahler(const RiverBranch *node)
+static inline int strahler(const RiverBranch &node, const std::vector<RiverBranch> &branches)
 {
 	// if node has no children it is a leaf with stream order 1
-	if (node->left == nullptr && node->right == nullptr) {
+	if (node.left < 0 && node.right < 0) {
 		return 1;
 	}
 
-	int left = (node->left != nullptr) ? node->left->streamorder : 0;
-	int right = (node->right != nullptr) ? node->right->streamorder : 0;
+	int left = (node.left >= 0) ? branches[node.left].streamorder : 0;
+	int right = (node.right >= 0) ? branches[node.right].streamorder : 0;
 
 	if (left == right) {
 		return std::max(left, right) + 1;
@@ -83,84 +45,93 @@ static inline int strahler(const RiverBranch *node)
 
 // Shreve stream order
 // https://en.wikipedia.org/wiki/Stream_order#Shreve_stream_order
-static inline int shreve(const RiverBranch *node)
+static inline int shreve(const RiverBranch &node, const std::vector<RiverBranch> &branches)
 {
 	// if node has no children it is a leaf with stream order 1
-	if (node->left == nullptr && node->right == nullptr) {
+	if (node.left < 0 && node.right < 0) {
 		return 1;
 	}
 
-	int left = (node->left != nullptr) ? node->left->streamorder : 0;
-	int right = (node->right != nullptr) ? node->right->streamorder : 0;
+	int left = (node.left >= 0) ? branches[node.left].streamorder : 0;
+	int right = (node.right >= 0) ? branches[node.right].streamorder : 0;
 
 	return left + right;
 }
 
-static inline int postorder_level(RiverBranch *node)
+static inline int postorder_level(const RiverBranch &node, const std::vector<RiverBranch> &branches)
 {
-	if (node->left == nullptr && node->right == nullptr) {
+	if (node.left < 0 && node.right < 0) {
 		return 0;
 	}
 
-	if (node->left != nullptr && node->right != nullptr) {
-		return std::max(node->left->depth, node->right->depth) + 1;
+	if (node.left >= 0 && node.right >= 0) {
+		return std::max(branches[node.left].depth, branches[node.right].depth) + 1;
 	}
 
-	if (node->left) { return node->left->depth + 1; }
-	if (node->right) { return node->right->depth + 1; }
+	if (node.left >= 0) { return branches[node.left].depth + 1; }
+	if (node.right >= 0) { return branches[node.right].depth + 1; }
 
 	return 0;
 }
 
-// post order tree traversal
-static void stream_postorder(DrainageBasin *tree)
+// branches are stored in breadth first order so a child always comes after its parent
+// walking the array backwards visits every child before its parent, same as a post order traversal
+static void stream_postorder(std::vector<RiverBranch> &branches, size_t first, size_t last)
 {
-	std::list<RiverBranch*> stack;
-	RiverBranch *prev = nullptr;
-	stack.push_back(tree->mouth);
-
-	while (!stack.empty()) {
-		RiverBranch *current = stack.back();
-
-		if (prev == nullptr || prev->left == current || prev->right == current) {
-			if (current->left != nullptr) {
-				stack.push_back(current->left);
-			} else if (current->right != nullptr) {
-				stack.push_back(current->right);
-			} else {
-				current->streamorder = strahler(current);
-    				current->depth = postorder_level(current);
-				stack.pop_back();
-			}
-		} else if (current->left == prev) {
-			if (current->right != nullptr) {
-				stack.push_back(current->right);
-			} else {
-				current->streamorder = strahler(current);
-    				current->depth = postorder_level(current);
-				stack.pop_back();
-			}
-		} else if (current->right == prev) {
-			current->streamorder = strahler(current);
-    			current->depth = postorder_level(current);
-			stack.pop_back();
-		}
-
-		prev = current;
+	for (size_t i = last; i-- > first; ) {
+		RiverBranch &branch = branches[i];
+		branch.streamorder = strahler(branch, branches);
+		branch.depth = postorder_level(branch, branches);
 	}
 }
 
-static bool prunable(const RiverBranch *node, uint8_t min_stream)
+static bool prunable(const RiverBranch &node, uint8_t min_stream)
 {
-	return (node->streamorder < min_stream);
+	return (node.streamorder < min_stream);
+}
+
+// labels the connected groups of tiles for which the predicate holds
+// breadth first search on flat arrays, every tile is visited once
+template <typename Predicate>
+static void label_components(const geom::VoronoiGraph &graph, const std::vector<Tile> &tiles, Predicate predicate, TileComponents &components)
+{
+	components.labels.assign(tiles.size(), -1);
+	components.sizes.clear();
+
+	const auto &neighbors = graph.topology().cell_neighbors;
+
+	std::vector<uint32_t> queue;
+	queue.reserve(tiles.size());
+
+	for (const auto &root : tiles) {
+		if (components.labels[root.index] >= 0 || !predicate(root)) {
+			continue;
+		}
+
+		const int32_t label = components.sizes.size();
+		components.labels[root.index] = label;
+
+		queue.clear();
+		queue.push_back(root.index);
+		// the queue is never popped so its front is just a read position
+		for (size_t front = 0; front < queue.size(); front++) {
+			uint32_t node = queue[front];
+			for (uint32_t neighbor : neighbors[node]) {
+				if (components.labels[neighbor] < 0 && predicate(tiles[neighbor])) {
+					components.labels[neighbor] = label;
+					queue.push_back(neighbor);
+				}
+			}
+		}
+
+		components.sizes.push_back(queue.size());
+	}
 }
 
 Atlas::Atlas()
 {
-	const uint16_t size = 2048;
-	m_heightmap.resize(size, size, util::COLORSPACE_GRAYSCALE);
-	m_normalmap.resize(size, size, util::COLORSPACE_RGB);
-	m_mask.resize(size, size, util::COLORSPACE_GRAYSCALE);
+	const AtlasParameters defaults = {};
+	resize_maps(defaults.resolution);
 }
 	
 Atlas::~Atlas()
@@ -168,29 +139,180 @@ Atlas::~Atlas()
 	clear();
 }
 
-void Atlas::generate(int seed, const geom::Rectangle &bounds, const AtlasParameters &parameters)
+AtlasParameters huge_map_parameters(int tile_count)
+{
+	const AtlasParameters defaults = {};
+
+	AtlasParameters parameters = {};
+	parameters.tile_count = tile_count;
+
+	// the pixel count grows linearly with the tile count
+	const float growth = std::sqrt(float(tile_count) / float(defaults.tile_count));
+	const int resolution = growth * defaults.resolution;
+	parameters.resolution = glm::clamp(resolution, defaults.resolution, HUGE_MAP_MAX_RESOLUTION);
+
+	return parameters;
+}
+
+bool Atlas::generate(int seed, const geom::Rectangle &bounds, const AtlasParameters &parameters, util::Progress *progress)
 {
 	m_bounds = bounds;
+
+	// the resolution can come straight from the menu
+	// the height map stores its size in 16 bits while the tiled masks do not, so they only agree within these bounds
+	const int resolution = glm::clamp(parameters.resolution, ATLAS_MIN_RESOLUTION, HUGE_MAP_MAX_RESOLUTION);
+	if (m_heightmap.width() != resolution || m_heightmap.height() != resolution) {
+		resize_maps(resolution);
+	}
+
 	// clear all data
 	clear();
 
-	// generate the graph
-	std::mt19937 gen(seed);
-	
-	glm::vec2 scale = bounds.max - bounds.min;
+	const glm::vec2 scale = bounds.max - bounds.min;
 	std::vector<glm::vec2> points;
 
-	PoissonGenerator::DefaultPRNG PRNG(seed);
-	const auto positions = PoissonGenerator::generatePoissonPoints(parameters.tile_count, PRNG, false);
-	for (const auto &position : positions) {
-		glm::vec2 point = { scale.x * position.x, scale.y * position.y };
-		point += bounds.min;
-		points.push_back(point);
+	// every stage declares which stages it needs
+	// stages that do not depend on each other run concurrently
+	// each stage always sees the same input so the output is the same as when run in sequence
+	util::TaskGraph stages;
+
+	// generate the graph
+	auto poisson = stages.add("poisson", [&]() {
+		// sampled in the unit square with the spacing that gives about tile_count points
+		const float sample_count = 1.57079632679f * parameters.tile_count; // tile_count * 2 * pi / 4, same estimate as before
+		const float min_distance = 1.f / std::sqrt(sample_count);
+		const geom::Rectangle unit = { glm::vec2(0.f), glm::vec2(1.f) };
+		const auto positions = geom::poisson_disk_points(unit, min_distance, seed);
+		for (const auto &position : positions) {
+			glm::vec2 point = { scale.x * position.x, scale.y * position.y };
+			point += bounds.min;
+			points.push_back(point);
+		}
+	});
+
+	auto voronoi = stages.add("voronoi", [&]() {
+		m_graph.generate(points, bounds, 2);
+		m_graph.build_cell_raster(TILE_RASTER_RES);
+	}, { poisson });
+
+	auto tiles = stages.add("tiles", [&]() {
+		create_tiles();
+	}, { voronoi });
+
+	// the height map noise only needs the bounds so it overlaps with the graph construction
+	auto noise = stages.add("heightmap_noise", [&]() {
+		FastNoise fastnoise;
+		fastnoise.SetSeed(seed);
+		fastnoise.SetNoiseType(FastNoise::SimplexFractal);
+		fastnoise.SetFractalType(FastNoise::FBM);
+		fastnoise.SetFrequency(parameters.noise_frequency);
+		fastnoise.SetFractalOctaves(parameters.noise_octaves);
+		fastnoise.SetFractalLacunarity(parameters.noise_lacunarity);
+		fastnoise.SetPerturbFrequency(parameters.perturb_frequency);
+		fastnoise.SetGradientPerturbAmp(parameters.perturb_amp);
+
+		// fill image with noise
+		const glm::vec2 image_scale = {
+			scale.x / float(m_heightmap.width()),
+			scale.y / float(m_heightmap.height())
+		};
+
+		util::noise_image(m_heightmap, &fastnoise, image_scale, util::CHANNEL_RED);
+	});
+
+	auto relief = stages.add("relief", [&]() {
+		for (auto &tile : m_tiles) {
+			glm::vec2 center = m_graph.cells[tile.index].center;
+			float x = center.x / scale.x; 
+			float y = center.y / scale.y;
+			tile.height = 255 * m_heightmap.sample_relative(x, y, util::CHANNEL_RED);
+			if (tile.height > parameters.mountains) {
+				tile.relief = ReliefType::MOUNTAINS;
+			} else if (tile.height > parameters.hills) {
+				tile.relief = ReliefType::HILLS;
+			} else if (tile.height > parameters.lowland) {
+				tile.relief = ReliefType::LOWLAND;
+			} else {
+				tile.relief = ReliefType::SEABED;
+			}
+		}
+	}, { tiles, noise });
+
+	// relief floodfill
+	auto floodfill = stages.add("floodfill", [&]() {
+		floodfill_relief(64, ReliefType::SEABED, ReliefType::LOWLAND);
+		floodfill_relief(4, ReliefType::MOUNTAINS, ReliefType::HILLS);
+
+		remove_echoriads();
+	}, { relief });
+
+	// islands, coasts and walls all set bits in the same flag words
+	// so they have to run one after the other
+	auto islands = stages.add("islands", [&]() {
+		mark_islands(64);
+	}, { floodfill });
+
+	auto coasts_walls = stages.add("coasts_walls", [&]() {
+		mark_coasts();
+		mark_walls();
+	}, { islands });
+
+	auto rivers = stages.add("form_rivers", [&]() {
+		form_rivers();
+	}, { coasts_walls });
+
+	// relief has been altered by rivers // and apply corrections
+	auto corrections = stages.add("relief_corrections", [&]() {
+		floodfill_relief(4, ReliefType::MOUNTAINS, ReliefType::HILLS);
+		mark_walls();
+	}, { rivers });
+
+	// the river lines are final once the rivers are formed
+	// so their mask can be drawn while the relief map is being created
+	// it reads the border flags so it waits for the corrections that write them
+	auto river_mask = stages.add("river_mask", [&]() {
+		draw_river_mask();
+	}, { corrections });
+
+	// alter height map
+	auto reliefmap = stages.add("create_reliefmap", [&]() {
+		create_reliefmap(seed);
+	}, { corrections });
+
+	auto river_cut = stages.add("river_cut_relief", [&]() {
+		river_cut_relief();
+	}, { reliefmap, river_mask });
+
+	// weather the final height map
+	stages.add("erosion", [&]() {
+		util::Eroder eroder;
+		eroder.erode(m_heightmap, parameters.erosion_iterations, parameters.erosion_resolution);
+	}, { river_cut });
+
+	const bool completed = stages.run(progress);
+
+	// keep track of how long each stage took
+	m_stage_times.clear();
+	for (util::TaskGraph::TaskID stage = 0; stage < stages.size(); stage++) {
+		m_stage_times.push_back({ stages.name(stage), stages.milliseconds(stage) });
 	}
 
-	m_graph.generate(points, bounds, 2);
+	//m_heightmap.normalize(util::CHANNEL_RED);
+
+	return completed;
+}
 
-	// create tile map
+void Atlas::resize_maps(int resolution)
+{
+	m_heightmap.resize(resolution, resolution, util::COLORSPACE_GRAYSCALE);
+	m_normalmap.resize(resolution, resolution, util::COLORSPACE_RGB);
+	// the masks only allocate the tiles that get drawn on
+	m_mask.resize(resolution, resolution, util::COLORSPACE_GRAYSCALE);
+	m_river_mask.resize(resolution, resolution, util::COLORSPACE_GRAYSCALE);
+}
+
+void Atlas::create_tiles()
+{
 	m_tiles.resize(m_graph.cells.size());
 	for (const auto &cell : m_graph.cells) {
 		Tile tile;
@@ -222,67 +344,6 @@ void Atlas::generate(int seed, const geom::Rectangle &bounds, const AtlasParamet
 			m_corners[edge.right_vertex->index].flags |= CORNER_FLAG_FRONTIER;
 		}
 	}
-
-	// create height map
-	FastNoise fastnoise;
-	fastnoise.SetSeed(seed);
-	fastnoise.SetNoiseType(FastNoise::SimplexFractal);
-	fastnoise.SetFractalType(FastNoise::FBM);
-	fastnoise.SetFrequency(parameters.noise_frequency);
-	fastnoise.SetFractalOctaves(parameters.noise_octaves);
-	fastnoise.SetFractalLacunarity(parameters.noise_lacunarity);
-	fastnoise.SetPerturbFrequency(parameters.perturb_frequency);
-	fastnoise.SetGradientPerturbAmp(parameters.perturb_amp);
-
-	// fill image with noise
-	const glm::vec2 image_scale = {
-		scale.x / float(m_heightmap.width()),
-		scale.y / float(m_heightmap.height())
-	};
-
-	util::noise_image(m_heightmap, &fastnoise, image_scale, util::CHANNEL_RED);
-	
-	//util::Eroder eroder;
-	//eroder.erode(m_heightmap);
-
-	for (auto &tile : m_tiles) {
-		glm::vec2 center = m_graph.cells[tile.index].center;
-		float x = center.x / scale.x; 
-		float y = center.y / scale.y;
-		tile.height = 255 * m_heightmap.sample_relative(x, y, util::CHANNEL_RED);
-		if (tile.height > parameters.mountains) {
-			tile.relief = ReliefType::MOUNTAINS;
-		} else if (tile.height > parameters.hills) {
-			tile.relief = ReliefType::HILLS;
-		} else if (tile.height > parameters.lowland) {
-			tile.relief = ReliefType::LOWLAND;
-		} else {
-			tile.relief = ReliefType::SEABED;
-		}
-	}
-
-	// relief floodfill
-	floodfill_relief(64, ReliefType::SEABED, ReliefType::LOWLAND);
-	floodfill_relief(4, ReliefType::MOUNTAINS, ReliefType::HILLS);
-
-	remove_echoriads();
-
-	mark_islands(64);
-
-	mark_coasts();
-
-	mark_walls();
-
-	form_rivers();
-
-	// relief has been altered by rivers // and apply corrections
-	floodfill_relief(4, ReliefType::MOUNTAINS, ReliefType::HILLS);
-	mark_walls();
-
-	// alter height map
-	create_reliefmap(seed);
-	river_cut_relief();
-	//m_heightmap.normalize(util::CHANNEL_RED);
 }
 	
 void Atlas::clear()
@@ -297,6 +358,7 @@ void Atlas::clear()
 
 	m_heightmap.wipe();
 	m_mask.wipe();
+	m_river_mask.wipe();
 }
 	
 const geom::VoronoiGraph& Atlas::graph() const
@@ -324,7 +386,12 @@ const util::Image<float>& Atlas::heightmap() const
 	return m_heightmap;
 }
 
-const util::Image<float>& Atlas::normalmap() const
+util::Image<float>& Atlas::heightmap()
+{
+	return m_heightmap;
+}
+
+const util::Image<uint8_t>& Atlas::normalmap() const
 {
 	return m_normalmap;
 }
@@ -340,6 +407,17 @@ const Tile* Atlas::tile_at(const glm::vec2 &position) const
 	return nullptr;
 }
 	
+void Atlas::tiles_at(std::span<const glm::vec2> positions, std::vector<const Tile*> &output) const
+{
+	std::vector<uint32_t> indices(positions.size());
+	m_graph.cells_at(positions, indices);
+
+	output.resize(positions.size());
+	for (size_t i = 0; i < positions.size(); i++) {
+		output[i] = indices[i] != geom::VORONOI_NO_CELL ? &m_tiles[indices[i]] : nullptr;
+	}
+}
+	
 glm::vec2 Atlas::tile_center(uint32_t index) const
 {
 	return m_graph.cells[index].center;
@@ -349,130 +427,73 @@ const geom::Rectangle& Atlas::bounds() const
 {
 	return m_bounds;
 }
+	
+const std::vector<AtlasStageTime>& Atlas::stage_times() const
+{
+	return m_stage_times;
+}
 		
 void Atlas::floodfill_relief(unsigned max_size, ReliefType target, ReliefType replacement)
 {
-	const auto &cells = m_graph.cells;
-
-	std::unordered_map<uint32_t, bool> visited;
-
-	for (auto &root : m_tiles) {
-		std::vector<Tile*> marked;
-		if (visited[root.index] == false && root.relief == target) {
-			// breadth first search
-			visited[root.index] = true;
-			std::queue<uint32_t> queue;
-			queue.push(root.index);
-			
-			while (!queue.empty()) {
-				uint32_t node = queue.front();
-				queue.pop();
-
-				marked.push_back(&m_tiles[node]);
-
-				for (const auto &cell : cells[node].neighbors) {
-					Tile *neighbor = &m_tiles[cell->index];
-					if (visited[neighbor->index] == false) {
-						visited[neighbor->index] = true;
-						if (neighbor->relief == target) {
-							queue.push(neighbor->index);
-						}
-					}
-				}
-			}
-		}
+	TileComponents components;
+	label_components(m_graph, m_tiles, [target](const Tile &tile) { return tile.relief == target; }, components);
 
-		// now that the size is known replace with target
-		if (marked.size() > 0 && marked.size() < max_size) {
-			for (Tile *tile : marked) {
-				tile->relief = replacement;
-			}
+	// now that the sizes are known replace with target
+	for (auto &tile : m_tiles) {
+		int32_t label = components.labels[tile.index];
+		if (label >= 0 && components.sizes[label] < max_size) {
+			tile.relief = replacement;
 		}
 	}
 }
 	
 void Atlas::remove_echoriads()
 {
-	const auto &cells = m_graph.cells;
+	TileComponents components;
+	label_components(m_graph, m_tiles, [](const Tile &tile) { return walkable_tile(&tile); }, components);
 
-	std::unordered_map<uint32_t, bool> visited;
-	
-	for (auto &root : m_tiles) {
-		std::vector<Tile*> marked;
-		if (visited[root.index] == false && walkable_tile(&root) == true) {
-			bool found_water = false;
-			visited[root.index] = true;
-			std::queue<Tile*> queue;
-			queue.push(&root);
-			
-			while (!queue.empty()) {
-				Tile *tile = queue.front();
-				queue.pop();
-
-				marked.push_back(tile);
-				
-				for (const auto &cell : cells[tile->index].neighbors) {
-					Tile *neighbor = &m_tiles[cell->index];
-					if (neighbor->relief == ReliefType::SEABED) {
-						found_water = true;
-						break;
-					}
-					if (visited[neighbor->index] == false) {
-						visited[neighbor->index] = true;
-						if (walkable_tile(neighbor)) {
-							queue.push(neighbor);
-						}
-					}
-				}
-			}
+	std::vector<bool> found_water;
+	find_water(components, found_water);
 
-			if (found_water == false) {
-				for (Tile *tile : marked) {
-					tile->relief = ReliefType::MOUNTAINS;
-				}
-			}
+	// walkable regions that are cut off from the sea become mountains
+	for (auto &tile : m_tiles) {
+		int32_t label = components.labels[tile.index];
+		if (label >= 0 && !found_water[label]) {
+			tile.relief = ReliefType::MOUNTAINS;
 		}
 	}
 }
 	
 void Atlas::mark_islands(unsigned max_size)
 {
-	const auto &cells = m_graph.cells;
+	TileComponents components;
+	label_components(m_graph, m_tiles, [](const Tile &tile) { return walkable_tile(&tile); }, components);
 
-	std::unordered_map<uint32_t, bool> visited;
-	
-	for (auto &root : m_tiles) {
-		std::vector<Tile*> marked;
-		if (visited[root.index] == false && walkable_tile(&root) == true) {
-			bool found_water = false;
-			visited[root.index] = true;
-			std::queue<Tile*> queue;
-			queue.push(&root);
-			
-			while (!queue.empty()) {
-				Tile *tile = queue.front();
-				queue.pop();
-
-				marked.push_back(tile);
-				
-				for (const auto &cell : cells[tile->index].neighbors) {
-					Tile *neighbor = &m_tiles[cell->index];
-					if (neighbor->relief == ReliefType::SEABED) {
-						found_water = true;
-					}
-					if (visited[neighbor->index] == false) {
-						visited[neighbor->index] = true;
-						if (walkable_tile(neighbor)) {
-							queue.push(neighbor);
-						}
-					}
-				}
-			}
+	std::vector<bool> found_water;
+	find_water(components, found_water);
 
-			if (found_water == true && marked.size() < max_size) {
-				for (Tile *tile : marked) {
-					tile->flags |= TILE_FLAG_ISLAND;
-				}
+	for (auto &tile : m_tiles) {
+		int32_t label = components.labels[tile.index];
+		if (label >= 0 && found_water[label] && components.sizes[label] < max_size) {
+			tile.flags |= TILE_FLAG_ISLAND;
+		}
+	}
+}
+
+// which components have at least one tile next to the sea
+void Atlas::find_water(const TileComponents &components, std::vector<bool> &found_water) const
+{
+	found_water.assign(components.sizes.size(), false);
+
+	for (const auto &tile : m_tiles) {
+		int32_t label = components.labels[tile.index];
+		if (label < 0 || found_water[label]) {
+			continue;
+		}
+		for (uint32_t neighbor : m_graph.topology().cell_neighbors[tile.index]) {
+			if (m_tiles[neighbor].relief == ReliefType::SEABED) {
+				found_water[label] = true;
+				break;
 			}
 		}
 	}
@@ -482,9 +503,8 @@ void Atlas::mark_coasts()
 {
 	for (auto &tile : m_tiles) {
 		bool local_land = tile.relief != ReliefType::SEABED;
-		for (const auto &cell : m_graph.cells[tile.index].neighbors) {
-			Tile *neighbor = &m_tiles[cell->index];
-			bool neighbor_land = neighbor->relief != ReliefType::SEABED;
+		for (uint32_t neighbor : m_graph.topology().cell_neighbors[tile.index]) {
+			bool neighbor_land = m_tiles[neighbor].relief != ReliefType::SEABED;
 			if (local_land ^ neighbor_land) {
 				tile.flags |= TILE_FLAG_COAST;
 			}
@@ -592,7 +612,7 @@ void Atlas::form_drainage_basins(const std::vector<const Corner*> &candidates)
 		int score = 0;
 	};
 	
-	std::unordered_map<const Corner*, Meta> lookup;
+	std::vector<Meta> lookup(m_corners.size());
 
 	// add starting weight based on elevation
 	// corners with higher elevation will get a higher weight
@@ -608,37 +628,42 @@ void Atlas::form_drainage_basins(const std::vector<const Corner*> &candidates)
 			}
 		}
 		Meta data = { false, weight, 0 };
-		lookup[node] = data;
+		lookup[node->index] = data;
 	}
 
-	// breadth first search to start the drainage basin
-	// assign scores
+	// assign scores, the distance from the coast weighted by elevation
+	// the search starts from all coast corners at once and expands the lowest score first
+	// so a corner is only expanded again when it gets a lower score
+	using ScoredCorner = std::pair<int, uint32_t>;
+	std::priority_queue<ScoredCorner, std::vector<ScoredCorner>, std::greater<ScoredCorner>> frontier;
 	for (auto root : candidates) {
 		if (root->flags & CORNER_FLAG_COAST) {
-			std::queue<const Corner*> frontier;
-			lookup[root].visited = true;
-			frontier.push(root);
-			while (!frontier.empty()) {
-				const Corner *corner = frontier.front();
-				frontier.pop();
-				Meta &data = lookup[corner];
-				int depth = data.score + data.elevation + 1;
-				for (const auto &vertex : m_graph.vertices[corner->index].adjacent) {
-					const Corner *neighbor = &m_corners[vertex->index];
-					bool river = neighbor->flags & CORNER_FLAG_RIVER;
-					bool coast = neighbor->flags & CORNER_FLAG_COAST;
-					if (river && !coast) {
-						Meta &neighbor_data = lookup[neighbor];
-
-						if (!neighbor_data.visited) {
-							neighbor_data.visited = true;
-							neighbor_data.score = depth;
-							frontier.push(neighbor);
-						} else if (neighbor_data.score > depth && neighbor_data.elevation >= data.elevation) {
-							neighbor_data.score = depth;
-							frontier.push(neighbor);
-						}
-					}
+			lookup[root->index].visited = true;
+			frontier.push({ lookup[root->index].score, root->index });
+		}
+	}
+	while (!frontier.empty()) {
+		const auto [score, corner] = frontier.top();
+		frontier.pop();
+		Meta &data = lookup[corner];
+		if (score != data.score) {
+			continue; // the corner got a lower score after this entry was queued
+		}
+		int depth = data.score + data.elevation + 1;
+		for (uint32_t index : m_graph.topology().vertex_adjacent[corner]) {
+			const Corner *neighbor = &m_corners[index];
+			bool river = neighbor->flags & CORNER_FLAG_RIVER;
+			bool coast = neighbor->flags & CORNER_FLAG_COAST;
+			if (river && !coast) {
+				Meta &neighbor_data = lookup[index];
+
+				if (!neighbor_data.visited) {
+					neighbor_data.visited = true;
+					neighbor_data.score = depth;
+					frontier.push({ depth, index });
+				} else if (neighbor_data.score > depth && neighbor_data.elevation >= data.elevation) {
+					neighbor_data.score = depth;
+					frontier.push({ depth, index });
 				}
 			}
 		}
@@ -646,63 +671,89 @@ void Atlas::form_drainage_basins(const std::vector<const Corner*> &candidates)
 
 	// reset visited
 	for (auto node : candidates) {
-		lookup[node].visited = false;
+		lookup[node->index].visited = false;
 	}
 
+	// every candidate corner ends up in at most one branch
+	// so the arena never has to grow while the trees are built
+	m_branches.reserve(candidates.size());
+
 	// create the drainage basin binary trees
+	// the branches of a basin are appended in breadth first order
 	for (auto root : candidates) {
 		if (root->flags & CORNER_FLAG_COAST) {
-			lookup[root].visited = true;
+			lookup[root->index].visited = true;
 			// new drainage basin
 			DrainageBasin basin = {};
-			basin.mouth = create_branch(root);
-			std::queue<RiverBranch*> frontier;
-			frontier.push(basin.mouth);
-			while (!frontier.empty()) {
-				RiverBranch *fork = frontier.front(); frontier.pop();
-				const Corner *corner = fork->confluence;
+			basin.mouth = create_branch(root->index);
+			for (size_t front = basin.mouth; front < m_branches.size(); front++) {
+				const uint32_t corner = m_branches[front].confluence;
 				Meta &corner_data = lookup[corner];
-				for (const auto &vertex : m_graph.vertices[corner->index].adjacent) {
+				for (const auto &vertex : m_graph.vertices[corner].adjacent) {
 					const Corner *neighbor = &m_corners[vertex->index];
-					Meta &neighbor_data = lookup[neighbor];
+					Meta &neighbor_data = lookup[neighbor->index];
 					bool coast = neighbor->flags & CORNER_FLAG_COAST;
 					if (!neighbor_data.visited && !coast) {
 						if (neighbor_data.score > corner_data.score && neighbor_data.elevation >= corner_data.elevation) {
 							neighbor_data.visited = true;
 							// create a new branch
-							RiverBranch *child = create_branch(neighbor);
-							frontier.push(child);
-							if (fork->left == nullptr) {
-								fork->left = child;
-							} else if (fork->right == nullptr) {
-								fork->right = child;
+							int32_t child = create_branch(neighbor->index);
+							RiverBranch &fork = m_branches[front];
+							if (fork.left < 0) {
+								fork.left = child;
+							} else if (fork.right < 0) {
+								fork.right = child;
 							}
 						}
 					}
 				}
 			}
 
-			basins.push_back(basin);
+			// assign stream order numbers
+			stream_postorder(m_branches, basin.mouth, m_branches.size());
+
+			m_basins.push_back(basin);
 		}
 	}
+}
+
+int32_t Atlas::create_branch(uint32_t confluence)
+{
+	RiverBranch branch;
+	branch.confluence = confluence;
+	branch.streamorder = 1;
 
-	// assign stream order numbers
-	for (auto &basin : basins) {
-		stream_postorder(&basin);
+	m_branches.push_back(branch);
+
+	return m_branches.size() - 1;
+}
+
+template <typename Visitor>
+void Atlas::visit_branches(const DrainageBasin &basin, Visitor visitor)
+{
+	// breadth first, the visitor can detach the children of the current branch before they are queued
+	m_branch_queue.clear();
+	m_branch_queue.push_back(basin.mouth);
+	for (size_t front = 0; front < m_branch_queue.size(); front++) {
+		const int32_t current = m_branch_queue[front];
+		visitor(current);
+		const RiverBranch &branch = m_branches[current];
+		if (branch.right >= 0) {
+			m_branch_queue.push_back(branch.right);
+		}
+		if (branch.left >= 0) {
+			m_branch_queue.push_back(branch.left);
+		}
 	}
 }
 	
 void Atlas::river_erode_mountains(size_t min)
 {
-	for (auto it = basins.begin(); it != basins.end(); ) {
-		DrainageBasin &bas = *it;
-		std::queue<RiverBranch*> queue;
-		queue.push(bas.mouth);
-		while (!queue.empty()) {
-			RiverBranch *cur = queue.front(); queue.pop();
-
-			if (cur->streamorder > min) {
-				const auto &vertex = m_graph.vertices[cur->confluence->index];
+	for (const auto &basin : m_basins) {
+		visit_branches(basin, [&](int32_t current) {
+			const RiverBranch &branch = m_branches[current];
+			if (branch.streamorder > min) {
+				const auto &vertex = m_graph.vertices[branch.confluence];
 				for (const auto &cell : vertex.cells) {
 					auto &tile = m_tiles[cell->index];
 					if (tile.relief == ReliefType::MOUNTAINS) {
@@ -710,58 +761,39 @@ void Atlas::river_erode_mountains(size_t min)
 					}
 				}
 			}
-
-			if (cur->right != nullptr) {
-				queue.push(cur->right);
-			}
-			if (cur->left != nullptr) {
-				queue.push(cur->left);
-			}
-		}
-		++it;
+		});
 	}
 }
 	
 void Atlas::trim_drainage_basins(size_t min)
 {
 	// prune binary tree branch if the stream order is too low
-	for (auto it = basins.begin(); it != basins.end(); ) {
-		DrainageBasin &bas = *it;
-		std::queue<RiverBranch*> queue;
-		queue.push(bas.mouth);
-		while (!queue.empty()) {
-			RiverBranch *cur = queue.front(); queue.pop();
-			if (cur->right != nullptr) {
-				if (prunable(cur->right, min)) {
-					prune_branches(cur->right);
-					cur->right = nullptr;
-				} else {
-					queue.push(cur->right);
-				}
+	// pruned branches simply stay behind in the arena until the next generation
+	for (const auto &basin : m_basins) {
+		visit_branches(basin, [&](int32_t current) {
+			RiverBranch &branch = m_branches[current];
+			if (branch.right >= 0 && prunable(m_branches[branch.right], min)) {
+				branch.right = -1;
 			}
-			if (cur->left != nullptr) {
-				if (prunable(cur->left, min)) {
-					prune_branches(cur->left);
-					cur->left = nullptr;
-				} else {
-					queue.push(cur->left);
-				}
+			if (branch.left >= 0 && prunable(m_branches[branch.left], min)) {
+				branch.left = -1;
 			}
-		}
-		if (bas.mouth->right == nullptr && bas.mouth->left == nullptr) {
-			delete bas.mouth;
-			bas.mouth = nullptr;
-			it = basins.erase(it);
-		} else {
-			++it;
-		}
+		});
 	}
+
+	std::erase_if(m_basins, [&](const DrainageBasin &basin) {
+		const RiverBranch &mouth = m_branches[basin.mouth];
+		return mouth.right < 0 && mouth.left < 0;
+	});
 }
 	
 void Atlas::trim_rivers()
 {
 	// remove rivers too close to each other
-	static const float MIN_RIVER_DISTANCE = 4.F;
+	// relative to the tile spacing so rivers survive on maps with many small tiles
+	static const float MIN_RIVER_SPACING = 0.35F;
+	const glm::vec2 size = m_bounds.max - m_bounds.min;
+	const float min_river_distance = MIN_RIVER_SPACING * std::sqrt(size.x * size.y / m_tiles.size());
 	for (auto &border : m_borders) {
 		if (!(border.flags & BORDER_FLAG_RIVER)) {
 			const auto &edge = m_graph.edges[border.index];
@@ -771,7 +803,7 @@ void Atlas::trim_rivers()
 			auto &right = m_corners[edge.right_vertex->index];
 			if ((left.flags & CORNER_FLAG_RIVER) && (right.flags & CORNER_FLAG_RIVER)) {
 				float d = glm::distance(edge.left_vertex->position, edge.right_vertex->position);
-				if (d < MIN_RIVER_DISTANCE) {
+				if (d < min_river_distance) {
 					if (left.river_depth > right.river_depth) {
 						right.flags &= ~CORNER_FLAG_RIVER;
 					} else {
@@ -797,118 +829,87 @@ void Atlas::trim_rivers()
 	}
 
 	// do the actual pruning in the basin
-	for (auto it = basins.begin(); it != basins.end(); ) {
-		DrainageBasin &basin = *it;
-		std::queue<RiverBranch*> queue;
-		queue.push(basin.mouth);
-		while (!queue.empty()) {
-			RiverBranch *cur = queue.front();
-			queue.pop();
-
-			if (cur->right != nullptr) {
-				if ((cur->right->confluence->flags & CORNER_FLAG_RIVER) == false) {
-					prune_branches(cur->right);
-					cur->right = nullptr;
-				} else {
-					queue.push(cur->right);
-				}
+	for (const auto &basin : m_basins) {
+		visit_branches(basin, [&](int32_t current) {
+			RiverBranch &branch = m_branches[current];
+			if (branch.right >= 0 && (m_corners[m_branches[branch.right].confluence].flags & CORNER_FLAG_RIVER) == false) {
+				branch.right = -1;
 			}
-			if (cur->left != nullptr) {
-				if ((cur->left->confluence->flags & CORNER_FLAG_RIVER) == false) {
-					prune_branches(cur->left);
-					cur->left = nullptr;
-				} else {
-					queue.push(cur->left);
-				}
+			if (branch.left >= 0 && (m_corners[m_branches[branch.left].confluence].flags & CORNER_FLAG_RIVER) == false) {
+				branch.left = -1;
 			}
-		}
-		if (basin.mouth->right == nullptr && basin.mouth->left == nullptr) {
-			delete basin.mouth;
-			basin.mouth = nullptr;
-			it = basins.erase(it);
-		} else {
-			++it;
-		}
+		});
 	}
+
+	std::erase_if(m_basins, [&](const DrainageBasin &basin) {
+		const RiverBranch &mouth = m_branches[basin.mouth];
+		return mouth.right < 0 && mouth.left < 0;
+	});
 }
 
 void Atlas::prune_stubby_rivers(uint8_t min_branch, uint8_t min_basin)
 {
-	std::unordered_map<const RiverBranch*, int> depth;
-	std::unordered_map<const RiverBranch*, bool> removable;
-	std::unordered_map<RiverBranch*, RiverBranch*> parents;
-	std::vector<RiverBranch*> endnodes;
+	auto &depth = m_branch_depths;
+	auto &removable = m_branch_removable;
+	auto &parents = m_branch_parents;
+	auto &endnodes = m_branch_ends;
+	depth.assign(m_branches.size(), 0);
+	removable.assign(m_branches.size(), false);
+	parents.assign(m_branches.size(), -1);
+	endnodes.clear();
 
 	// find river end nodes
-	for (auto it = basins.begin(); it != basins.end(); ) {
-		DrainageBasin &bas = *it;
-		std::queue<RiverBranch*> queue;
-		queue.push(bas.mouth);
-		parents[bas.mouth] = nullptr;
-		removable[bas.mouth] = false;
-		while (!queue.empty()) {
-			RiverBranch *cur = queue.front();
-			depth[cur] = -1;
-			queue.pop();
-			if (cur->right == nullptr && cur->left == nullptr) {
-				endnodes.push_back(cur);
-				depth[cur] = 0;
+	for (const auto &basin : m_basins) {
+		visit_branches(basin, [&](int32_t current) {
+			const RiverBranch &branch = m_branches[current];
+			depth[current] = -1;
+			if (branch.right < 0 && branch.left < 0) {
+				endnodes.push_back(current);
+				depth[current] = 0;
 			} else {
-				if (cur->right != nullptr) {
-					queue.push(cur->right);
-					parents[cur->right] = cur;
+				if (branch.right >= 0) {
+					parents[branch.right] = current;
 				}
-				if (cur->left != nullptr) {
-					queue.push(cur->left);
-					parents[cur->left] = cur;
+				if (branch.left >= 0) {
+					parents[branch.left] = current;
 				}
 			}
-
-		}
-		++it;
+		});
 	}
 
 	// starting from end nodes assign depth to nodes until they reach a branch
-	for (auto &node : endnodes) {
-		std::queue<RiverBranch*> queue;
-		queue.push(node);
-		while (!queue.empty()) {
-			RiverBranch *cur = queue.front();
-			queue.pop();
-			RiverBranch *parent = parents[cur];
-			if (parent) {
-				depth[parent] = depth[cur] + 1;
-				if (parent->left != nullptr && parent->right != nullptr) {
+	for (int32_t current : endnodes) {
+		while (current >= 0) {
+			int32_t parent = parents[current];
+			int32_t next = -1;
+			if (parent >= 0) {
+				depth[parent] = depth[current] + 1;
+				RiverBranch &fork = m_branches[parent];
+				if (fork.left >= 0 && fork.right >= 0) {
 				// reached a branch
-					if (depth[cur] > -1 && depth[cur] < min_branch) {
-						prune_branches(cur);
-						if (cur == parent->left) {
-							parent->left = nullptr;
-						} else if (cur == parent->right) {
-							parent->right = nullptr;
+					if (depth[current] > -1 && depth[current] < min_branch) {
+						if (current == fork.left) {
+							fork.left = -1;
+						} else if (current == fork.right) {
+							fork.right = -1;
 						}
 					}
 				} else {
-					queue.push(parent);
+					next = parent;
 				}
-			} else if (depth[cur] < min_basin) {
+			} else if (depth[current] < min_basin) {
 			// reached the river mouth
 			// river is simply too small so mark it for deletion
-				removable[cur] = true;
+				removable[current] = true;
 			}
+			current = next;
 		}
 	}
 
 	// remove river basins if they are too small
-	for (auto it = basins.begin(); it != basins.end(); ) {
-		DrainageBasin &bas = *it;
-		if (removable[bas.mouth]) {
-			delete_basin(&bas);
-			it = basins.erase(it);
-		} else {
-			it++;
-		}
-	}
+	std::erase_if(m_basins, [&](const DrainageBasin &basin) {
+		return removable[basin.mouth];
+	});
 }
 
 // assign river data from basins to the graph data
@@ -925,39 +926,27 @@ void Atlas::assign_rivers()
 		tile.flags &= ~TILE_FLAG_RIVER;
 	}
 
-	// link the borders with the river corners
-	std::map<std::pair<uint32_t, uint32_t>, Border*> link;
-	for (auto &border : m_borders) {
-		border.flags &= ~BORDER_FLAG_RIVER;
-		const auto &edge = m_graph.edges[border.index];
-		link[std::minmax(edge.left_vertex->index, edge.right_vertex->index)] = &border;
-	}
+	// the border between a branch and its child is part of the river
+	const auto &topology = m_graph.topology();
+	auto link = [&](uint32_t a, uint32_t b) {
+		uint32_t edge = 0;
+		if (topology.edge_between(a, b, edge)) {
+			m_borders[edge].flags |= BORDER_FLAG_RIVER;
+		}
+	};
 
-	for (const auto &basin : basins) {
-		if (basin.mouth) {
-			std::queue<RiverBranch*> queue;
-			queue.push(basin.mouth);
-			while (!queue.empty()) {
-				RiverBranch *cur = queue.front(); queue.pop();
-				m_corners[cur->confluence->index].flags |= CORNER_FLAG_RIVER;
-				m_corners[cur->confluence->index].river_depth = cur->depth;
-				if (cur->right != nullptr) {
-					Border *bord = link[std::minmax(cur->confluence->index, cur->right->confluence->index)];
-					if (bord) { 
-						bord->flags |= BORDER_FLAG_RIVER;
-					}
-					queue.push(cur->right);
-				}
-				if (cur->left != nullptr) {
-					Border *bord = link[std::minmax(cur->confluence->index, cur->left->confluence->index)];
-					if (bord) { 
-						bord->flags |= BORDER_FLAG_RIVER;
-					}
-					queue.push(cur->left);
-				}
+	for (const auto &basin : m_basins) {
+		visit_branches(basin, [&](int32_t current) {
+			const RiverBranch &branch = m_branches[current];
+			m_corners[branch.confluence].flags |= CORNER_FLAG_RIVER;
+			m_corners[branch.confluence].river_depth = branch.depth;
+			if (branch.right >= 0) {
+				link(branch.confluence, m_branches[branch.right].confluence);
 			}
-
-		}
+			if (branch.left >= 0) {
+				link(branch.confluence, m_branches[branch.left].confluence);
+			}
+		});
 	}
 
 	for (auto &tile : m_tiles) {
@@ -977,9 +966,8 @@ void Atlas::form_mountain_ridges()
 	// create initial candidate network
 	// only corners next to mountains are part of the network
 	std::vector<const Corner*> candidates;
-	std::unordered_map<uint32_t, bool> touches_mountain;
+	std::vector<bool> touches_mountain(m_corners.size(), false);
 	for (const auto &corner : m_corners) {
-		touches_mountain[corner.index] = false;
 		const auto &vertex = m_graph.vertices[corner.index];
 		// find if corner touches mountains
 		for (const auto &cell : vertex.cells) {
@@ -996,43 +984,32 @@ void Atlas::form_mountain_ridges()
 		bool visited = false;
 		int score = 0;
 	};
-	std::unordered_map<const Corner*, Meta> lookup;
+	std::vector<Meta> lookup(m_corners.size());
 
-	// starting scores
-	for (auto node : candidates) {
-		Meta data = { false, 0 };
-		lookup[node] = data;
-	}
-
-	// do breadth first search for each mountain corner to find the closest "exit" out of the mountains
+	// do breadth first search from all mountain walls at once to find the closest "exit" out of the mountains
 	// this creates something similar to a drainage network
 	// this drainage network is used to define the mountain ridges
+	std::queue<const Corner*> frontier;
 	for (auto root : candidates) {
 		if (root->flags & CORNER_FLAG_WALL) {
-			std::queue<const Corner*> frontier;
-			lookup[root].visited = true;
+			lookup[root->index].visited = true;
 			frontier.push(root);
-			while (!frontier.empty()) {
-				const Corner *corner = frontier.front();
-				frontier.pop();
-				Meta &data = lookup[corner];
-				int depth = data.score + 1;
-				for (const auto &vertex : m_graph.vertices[corner->index].adjacent) {
-					const Corner *neighbor = &m_corners[vertex->index];
-					bool mountain = touches_mountain[neighbor->index];
-					bool wall = neighbor->flags & CORNER_FLAG_WALL;
-					if (mountain && !wall) {
-						Meta &neighbor_data = lookup[neighbor];
-
-						if (!neighbor_data.visited) {
-							neighbor_data.visited = true;
-							neighbor_data.score = depth;
-							frontier.push(neighbor);
-						} else if (neighbor_data.score > depth) {
-							neighbor_data.score = depth;
-							frontier.push(neighbor);
-						}
-					}
+		}
+	}
+	while (!frontier.empty()) {
+		const Corner *corner = frontier.front();
+		frontier.pop();
+		int depth = lookup[corner->index].score + 1;
+		for (const auto &vertex : m_graph.vertices[corner->index].adjacent) {
+			const Corner *neighbor = &m_corners[vertex->index];
+			bool mountain = touches_mountain[neighbor->index];
+			bool wall = neighbor->flags & CORNER_FLAG_WALL;
+			if (mountain && !wall) {
+				Meta &neighbor_data = lookup[neighbor->index];
+				if (!neighbor_data.visited) {
+					neighbor_data.visited = true;
+					neighbor_data.score = depth;
+					frontier.push(neighbor);
 				}
 			}
 		}
@@ -1040,41 +1017,35 @@ void Atlas::form_mountain_ridges()
 
 	// now that we have the scores create the mountain valley network
 	// true if a border is a valley
-	std::unordered_map<uint32_t, bool> valleys;
-
-	// link the borders with the river corners
-	std::map<std::pair<uint32_t, uint32_t>, uint32_t> link;
-	for (const auto &border : m_borders) {
-		const auto &edge = m_graph.edges[border.index];
-		link[std::minmax(edge.left_vertex->index, edge.right_vertex->index)] = border.index;
-	}
+	std::vector<bool> valleys(m_borders.size(), false);
 
 	// reset visited
 	for (auto node : candidates) {
-		lookup[node].visited = false;
+		lookup[node->index].visited = false;
 	}
 
 	// create the drainage basin binary trees
 	for (auto root : candidates) {
 		if (root->flags & CORNER_FLAG_WALL) {
-			std::queue<const Corner*> frontier;
-			lookup[root].visited = true;
+			lookup[root->index].visited = true;
 			frontier.push(root);
 			while (!frontier.empty()) {
 				const Corner *corner = frontier.front();
 				frontier.pop();
-				Meta &data = lookup[corner];
+				Meta &data = lookup[corner->index];
 				for (const auto &vertex : m_graph.vertices[corner->index].adjacent) {
 					const Corner *neighbor = &m_corners[vertex->index];
-					Meta &neighbor_data = lookup[neighbor];
+					Meta &neighbor_data = lookup[neighbor->index];
 					bool wall = neighbor->flags & CORNER_FLAG_WALL;
 					if (!neighbor_data.visited && !wall) {
 						if (neighbor_data.score > data.score) {
 							neighbor_data.visited = true;
 							frontier.push(neighbor);
 							// mark valley
-							auto bord = link[std::minmax(corner->index, neighbor->index)];
-							valleys[bord] = true;
+							uint32_t edge = 0;
+							if (m_graph.topology().edge_between(corner->index, neighbor->index, edge)) {
+								valleys[edge] = true;
+							}
 						}
 					}
 				}
@@ -1106,66 +1077,58 @@ void Atlas::form_mountain_ridges()
 	m_mask.blur(1.f);
 
 	// finally apply the mountain ridges to the heightmap
-	#pragma omp parallel for
-	for (int x = 0; x < m_heightmap.width(); x++) {
-		for (int y = 0; y < m_heightmap.height(); y++) {
+	m_mask.for_each_pixel(util::CHANNEL_RED, [&](int x, int y, uint8_t amp) {
+		if (amp) {
 			float height = m_heightmap.sample(x, y, util::CHANNEL_RED);
-			uint8_t amp = m_mask.sample(x, y, util::CHANNEL_RED);
-			if (amp) {
-				height += 0.1f * (amp / 255.f);
-				m_heightmap.plot(x, y, util::CHANNEL_RED, height);
-			}
+			height += 0.1f * (amp / 255.f);
+			m_heightmap.plot(x, y, util::CHANNEL_RED, height);
 		}
-	}
+	});
 }
 	
 void Atlas::form_base_relief()
 {
+	const auto &topology = m_graph.topology();
+
 	// the mountain tiles have an amp score
 	// the closer a mountain tile is to a non mountain tile the lower the score
 	struct Meta {
 		bool visited = false;
 		int score = 0;
 	};
-	std::unordered_map<const Tile*, Meta> lookup;
+	std::vector<Meta> lookup(m_tiles.size());
 
 	std::vector<const Tile*> roots; // mountain tiles to start breadth first search
 	for (const auto &tile : m_tiles) {
-		Meta data = { false, 0 };
 		if (tile.relief == ReliefType::MOUNTAINS) {
 			bool mountain_border = false;
-			for (const auto &cell : m_graph.cells[tile.index].neighbors) {
-				Tile *neighbor = &m_tiles[cell->index];
-				if (neighbor->relief != ReliefType::MOUNTAINS) {
+			for (uint32_t neighbor : topology.cell_neighbors[tile.index]) {
+				if (m_tiles[neighbor].relief != ReliefType::MOUNTAINS) {
 					mountain_border = true;
 					break;
 				}
 			}
 			if (mountain_border) {
 				roots.push_back(&tile);
-				data.visited = true;
+				lookup[tile.index].visited = true;
 			}
 		}
-		// starting scores
-		lookup[&tile] = data;
 	}
 
-
 	// do breadth first search to calculate score
 	for (const auto &root : roots) {
 		std::queue<const Tile*> frontier;
-		lookup[root].visited = true;
+		lookup[root->index].visited = true;
 		frontier.push(root);
 		while (!frontier.empty()) {
 			const Tile *tile = frontier.front();
 			frontier.pop();
-			Meta &data = lookup[tile];
-			int depth = data.score + 1;
-			for (const auto &cell : m_graph.cells[tile->index].neighbors) {
-				const Tile *neighbor = &m_tiles[cell->index];
+			int depth = lookup[tile->index].score + 1;
+			for (uint32_t index : topology.cell_neighbors[tile->index]) {
+				const Tile *neighbor = &m_tiles[index];
 				bool mountain = neighbor->relief == ReliefType::MOUNTAINS;
 				if (mountain) {
-					Meta &neighbor_data = lookup[neighbor];
+					Meta &neighbor_data = lookup[index];
 					if (!neighbor_data.visited) {
 						neighbor_data.visited = true;
 						neighbor_data.score = depth;
@@ -1181,41 +1144,80 @@ void Atlas::form_base_relief()
 
 	geom::Bounding<int> score_bounds = { 0, 5 };
 
-	// base per tile relief heightmap
-	#pragma omp parallel for
+	// translate mountain score to amplitude
+	std::vector<float> heights(m_tiles.size());
 	for (const auto &tile : m_tiles) {
 		float amp = 0.7f;
-		// translate mountain score to amplitude
 		if (tile.relief == ReliefType::MOUNTAINS) {
-			Meta &data = lookup[&tile];
 			// clamp the score within the bounds
-			int score = glm::clamp(data.score, score_bounds.min, score_bounds.max);
+			int score = glm::clamp(lookup[tile.index].score, score_bounds.min, score_bounds.max);
 			float mix = score / float(score_bounds.max);
 			amp = glm::mix(0.8f, 1.f, mix);
 		} else if (tile.relief == ReliefType::SEABED) {
 			amp = 0.3f;
 		}
+		heights[tile.index] = amp * (tile.height / 255.f);
+	}
 
-		// draw the triangles
-		glm::vec2 center = m_graph.cells[tile.index].center / m_bounds.max;
-		const auto &cell = m_graph.cells[tile.index];
-		for (auto &edge : cell.edges) {
-			const auto &left_vertex = edge->left_vertex;
-			const auto &right_vertex = edge->right_vertex;
-			glm::vec2 a = left_vertex->position / m_bounds.max;
-			glm::vec2 b = right_vertex->position / m_bounds.max;
-			//m_heightmap.draw_triangle_relative(center, a, b, util::CHANNEL_RED, amp * (tile.height / 255.f));
-			std::vector<glm::ivec2> pixels;
-			m_heightmap.find_triangle_pixels_relative(center, a, b, pixels);
-			for (const auto &pixel : pixels) {
-				float height = m_heightmap.sample(pixel.x, pixel.y, util::CHANNEL_RED);
-				height = glm::mix(height, amp * (tile.height / 255.f), 0.7f);
-				//height *= amp;
-				m_heightmap.plot(pixel.x, pixel.y, util::CHANNEL_RED, height);
+	// cells are binned in bands of rows so every band can be filled by its own thread without sharing a pixel
+	const int image_height = m_heightmap.height();
+	const int band_count = (image_height + RELIEF_BAND_ROWS - 1) / RELIEF_BAND_ROWS;
+	const glm::vec2 scale = glm::vec2(m_heightmap.width(), m_heightmap.height()) / m_bounds.max;
+
+	auto cell_rows = [&](uint32_t cell) -> geom::Bounding<int> {
+		float min_y = (std::numeric_limits<float>::max)();
+		float max_y = std::numeric_limits<float>::lowest();
+		for (uint32_t vertex : topology.cell_vertices[cell]) {
+			min_y = (std::min)(min_y, topology.vertex_positions[vertex].y * scale.y);
+			max_y = (std::max)(max_y, topology.vertex_positions[vertex].y * scale.y);
+		}
+		int first = glm::clamp(int(min_y) / RELIEF_BAND_ROWS, 0, band_count - 1);
+		int last = glm::clamp(int(max_y) / RELIEF_BAND_ROWS, 0, band_count - 1);
+		return { first, last };
+	};
+
+	std::vector<uint32_t> band_offsets(band_count + 1, 0);
+	for (const auto &tile : m_tiles) {
+		auto rows = cell_rows(tile.index);
+		for (int band = rows.min; band <= rows.max; band++) {
+			band_offsets[band + 1]++;
+		}
+	}
+	for (int band = 0; band < band_count; band++) {
+		band_offsets[band + 1] += band_offsets[band];
+	}
+	std::vector<uint32_t> band_cells(band_offsets.back());
+	std::vector<uint32_t> band_fill(band_offsets.begin(), band_offsets.end() - 1);
+	for (const auto &tile : m_tiles) {
+		auto rows = cell_rows(tile.index);
+		for (int band = rows.min; band <= rows.max; band++) {
+			band_cells[band_fill[band]++] = tile.index;
+		}
+	}
+
+	// base per tile relief heightmap
+	#pragma omp parallel for schedule(dynamic)
+	for (int band = 0; band < band_count; band++) {
+		const int first_row = band * RELIEF_BAND_ROWS;
+		const int last_row = (std::min)(first_row + RELIEF_BAND_ROWS, image_height);
+		std::vector<geom::Segment> outline;
+		for (uint32_t i = band_offsets[band]; i < band_offsets[band+1]; i++) {
+			const uint32_t cell = band_cells[i];
+			outline.clear();
+			for (uint32_t edge : topology.cell_edges[cell]) {
+				const glm::vec2 &a = topology.vertex_positions[topology.edge_vertices[2*edge]];
+				const glm::vec2 &b = topology.vertex_positions[topology.edge_vertices[2*edge+1]];
+				outline.push_back({ a * scale, b * scale });
 			}
+			const float target = heights[cell];
+			m_heightmap.fill_convex_polygon(outline, first_row, last_row, [&](int y, int x0, int x1) {
+				float *row = m_heightmap.row(y); // the height map has a single channel
+				for (int x = x0; x < x1; x++) {
+					row[x] = glm::mix(row[x], target, 0.7f);
+				}
+			});
 		}
 	}
-	
 }
 	
 void Atlas::create_reliefmap(int seed)
@@ -1224,7 +1226,7 @@ void Atlas::create_reliefmap(int seed)
 
 	form_mountain_ridges();
 
-	m_heightmap.blur(4.f);
+	m_heightmap.blur(4.f, m_blur_scratch);
 	
 	m_mask.blur(2.f);
 
@@ -1246,28 +1248,25 @@ void Atlas::create_reliefmap(int seed)
 	cellnoise.SetFrequency(0.2f);
 	cellnoise.SetCellularReturnType(FastNoise::Distance2Add);
 	
-	#pragma omp parallel for
-	for (int x = 0; x < m_heightmap.width(); x++) {
-		for (int y = 0; y < m_heightmap.height(); y++) {
-			uint8_t amp = m_mask.sample(x, y, util::CHANNEL_RED);
-			if (amp) {
-				float height = m_heightmap.sample(x, y, util::CHANNEL_RED);
-				float noise = 0.5f * (billow.GetNoise(x, y) + 1.f);
-				float peak = 0.08f * cellnoise.GetNoise(x, y);
-				height += 0.1f * noise;
-				height = glm::mix(height, height + peak, amp / 255.f);
-				m_heightmap.plot(x, y, util::CHANNEL_RED, height);
-			}
+	// only the mountain tiles of the mask have something to add
+	m_mask.for_each_pixel(util::CHANNEL_RED, [&](int x, int y, uint8_t amp) {
+		if (amp) {
+			float height = m_heightmap.sample(x, y, util::CHANNEL_RED);
+			float noise = 0.5f * (billow.GetNoise(x, y) + 1.f);
+			float peak = 0.08f * cellnoise.GetNoise(x, y);
+			height += 0.1f * noise;
+			height = glm::mix(height, height + peak, amp / 255.f);
+			m_heightmap.plot(x, y, util::CHANNEL_RED, height);
 		}
-	}
+	});
 
-	m_heightmap.blur(1.f);
+	m_heightmap.blur(1.f, m_blur_scratch);
 }
 
-void Atlas::river_cut_relief()
+void Atlas::draw_river_mask()
 {
 	// blank canvas
-	m_mask.wipe();
+	m_river_mask.wipe();
 
 	// add rivers as lines to the mask
 	#pragma omp parallel for
@@ -1278,49 +1277,37 @@ void Atlas::river_cut_relief()
 			const auto &right_vertex = edge.right_vertex;
 			glm::vec2 a = left_vertex->position / m_bounds.max;
 			glm::vec2 b = right_vertex->position / m_bounds.max;
-			m_mask.draw_thick_line_relative(a, b, 1, util::CHANNEL_RED, 255);
+			m_river_mask.draw_thick_line_relative(a, b, 1, util::CHANNEL_RED, 255);
 		}
 	}
 
 	// blur the mask a bit so we have smooth transition
-	m_mask.blur(1.f);
+	m_river_mask.blur(1.f);
+}
 
-	// now alter the heightmap based on the river mask
-	#pragma omp parallel for
-	for (int x = 0; x < m_heightmap.width(); x++) {
-		for (int y = 0; y < m_heightmap.height(); y++) {
-			uint8_t masker = m_mask.sample(x, y, util::CHANNEL_RED);
-			if (masker > 0) {
-				float height = m_heightmap.sample(x, y, util::CHANNEL_RED);
-				float erosion = glm::clamp(1.f - (masker / 255.f), 0.8f, 1.f);
-				m_heightmap.plot(x, y, util::CHANNEL_RED, erosion * height);
-			}
+void Atlas::river_cut_relief()
+{
+	// alter the heightmap based on the river mask
+	m_river_mask.for_each_pixel(util::CHANNEL_RED, [&](int x, int y, uint8_t masker) {
+		if (masker > 0) {
+			float height = m_heightmap.sample(x, y, util::CHANNEL_RED);
+			float erosion = glm::clamp(1.f - (masker / 255.f), 0.8f, 1.f);
+			m_heightmap.plot(x, y, util::CHANNEL_RED, erosion * height);
 		}
-	}
+	});
 }
 	
 void Atlas::create_normalmap()
 {
-	float strength = 16.f;
-
-	#pragma omp parallel for
-	for (int x = 0; x < m_heightmap.width(); x++) {
-		for (int y = 0; y < m_heightmap.height(); y++) {
-			const glm::vec3 normal = util::filter_normal(x, y, util::CHANNEL_RED, strength, m_heightmap);
-			m_normalmap.plot(x, y, util::CHANNEL_RED, normal.x);
-			m_normalmap.plot(x, y, util::CHANNEL_GREEN, normal.y);
-			m_normalmap.plot(x, y, util::CHANNEL_BLUE, normal.z);
-		}
-	}
+	// a loaded heightmap can have a different resolution, the normal map is resized to fit
+	util::normal_map(m_heightmap, util::CHANNEL_RED, 16.f, m_normalmap);
 }
 
 void Atlas::delete_basins()
 {
-	for (auto &basin : basins) {
-		delete_basin(&basin);
-	}
-
-	basins.clear();
+	// the branches live in the arena so there is nothing to free node by node
+	m_basins.clear();
+	m_branches.clear();
 }
 
 bool walkable_tile(const Tile *tile)
@@ -1,3 +1,5 @@
+#include "../util/tiledimage.h"
+#include "../util/progress.h"
 
 enum class ReliefType : uint8_t {
 	SEABED,
@@ -48,16 +50,18 @@ struct Tile {
 	ReliefType relief = ReliefType::SEABED;
 };
 
+// node of a drainage basin binary tree
+// branches are stored in one array and link to each other by index
 struct RiverBranch {
-	const Corner *confluence = nullptr;
-	RiverBranch *left = nullptr;
-	RiverBranch *right = nullptr;
+	uint32_t confluence = 0; // corner index
+	int32_t left = -1; // -1 if there is no child
+	int32_t right = -1;
 	int streamorder = 0;
 	int depth = 0;
 };
 
 struct DrainageBasin {
-	RiverBranch *mouth = nullptr; // binary tree root
+	int32_t mouth = -1; // binary tree root
 	size_t height = 0; // binary tree height
 };
 
@@ -79,8 +83,25 @@ void serialize(Archive &archive, Tile &tile)
 	archive(tile.index, tile.height, tile.relief, tile.flags);
 }
 
+// change this whenever the generator creates a different world from the same seed and parameters
+// so worlds cached by an older generator are not used anymore
+static const uint32_t ATLAS_GENERATOR_VERSION = 4;
+
+// resolution of the raster used to look up tiles at a position
+static const uint32_t TILE_RASTER_RES = 1024;
+
+// rows of the height map filled by a single thread when the base relief is drawn
+static const int RELIEF_BAND_ROWS = 32;
+
+// smallest height map the relief and erosion passes work on
+static const int ATLAS_MIN_RESOLUTION = 256;
+
+// largest height map of a huge map
+static const int HUGE_MAP_MAX_RESOLUTION = 4096;
+
 struct AtlasParameters {
 	int tile_count = 8000;
+	int resolution = 2048; // width and height of the heightmap in pixels
 	int lowland = 114;
 	int hills = 147;
 	int mountains = 168;
@@ -89,6 +110,25 @@ struct AtlasParameters {
 	float noise_lacunarity = 2.5f;
 	float perturb_frequency = 0.002f;
 	float perturb_amp = 250.f;
+	int erosion_iterations = 64; // hydraulic erosion steps, 0 turns erosion off
+	int erosion_resolution = 1024; // erosion runs on a copy of the heightmap scaled down to this size
+};
+
+// parameters for continent sized maps, far beyond the default tile count
+// the height map grows with the tile count so tiles keep about the same number of pixels as on a default map
+// up to HUGE_MAP_MAX_RESOLUTION, the erosion resolution stays the same so its cost does not grow
+AtlasParameters huge_map_parameters(int tile_count);
+
+// connected groups of tiles
+struct TileComponents {
+	std::vector<int32_t> labels; // component of each tile, -1 if it is not part of any
+	std::vector<uint32_t> sizes; // number of tiles in each component
+};
+
+// wall clock duration of a single world generation stage
+struct AtlasStageTime {
+	std::string stage;
+	float milliseconds = 0.f;
 };
 
 // generates a tile map with geography data (relief, temperatures, ...)
@@ -97,7 +137,8 @@ public:
 	Atlas();
 	~Atlas();
 public:
-	void generate(int seed, const geom::Rectangle &bounds, const AtlasParameters &parameters);
+	// stops early and returns false if the progress gets cancelled
+	bool generate(int seed, const geom::Rectangle &bounds, const AtlasParameters &parameters, util::Progress *progress = nullptr);
 	void create_normalmap();
 public:
 	const geom::VoronoiGraph& graph() const;
@@ -105,15 +146,34 @@ public:
 	const std::vector<Corner>& corners() const;
 	const std::vector<Border>& borders() const;
 	const util::Image<float>& heightmap() const;
-	const util::Image<float>& normalmap() const;
+	util::Image<float>& heightmap();
+	const util::Image<uint8_t>& normalmap() const;
 	const Tile* tile_at(const glm::vec2 &position) const;
+	// nullptr for positions outside the map
+	void tiles_at(std::span<const glm::vec2> positions, std::vector<const Tile*> &output) const;
 	glm::vec2 tile_center(uint32_t index) const;
 	const geom::Rectangle& bounds() const;
+	const std::vector<AtlasStageTime>& stage_times() const;
 public:
 	template <class Archive>
 	void serialize(Archive &archive)
 	{
 		archive(m_graph, m_tiles, m_corners, m_borders, m_heightmap, m_bounds);
+		if constexpr (Archive::is_loading::value) {
+			m_graph.build_cell_raster(TILE_RASTER_RES);
+		}
+	}
+	// everything except the height map, so the height map can be stored apart
+	template <class Archive>
+	void save_topology(Archive &archive) const
+	{
+		archive(m_graph, m_tiles, m_corners, m_borders, m_bounds);
+	}
+	template <class Archive>
+	void load_topology(Archive &archive)
+	{
+		archive(m_graph, m_tiles, m_corners, m_borders, m_bounds);
+		m_graph.build_cell_raster(TILE_RASTER_RES);
 	}
 private:
 	geom::Rectangle m_bounds;
@@ -122,17 +182,33 @@ private:
 	std::vector<Corner> m_corners;
 	std::vector<Border> m_borders;
 	util::Image<float> m_heightmap;
-	util::Image<float> m_normalmap;
-	util::Image<uint8_t> m_mask;
+	util::Image<uint8_t> m_normalmap;
+	util::TiledImage<uint8_t> m_mask;
+	util::TiledImage<uint8_t> m_river_mask;
+	util::BlurScratch<float> m_blur_scratch;
+	std::vector<AtlasStageTime> m_stage_times; // profiling data of the last generation
 private:
-	std::list<DrainageBasin> basins;
+	std::vector<RiverBranch> m_branches; // branches of all drainage basins
+	std::vector<DrainageBasin> m_basins;
+	std::vector<int32_t> m_branch_queue; // scratch space for tree traversal
+	// scratch space for pruning, kept so repeated prunes reuse the memory
+	std::vector<int> m_branch_depths;
+	std::vector<bool> m_branch_removable;
+	std::vector<int32_t> m_branch_parents;
+	std::vector<int32_t> m_branch_ends;
 	void delete_basins();
+	int32_t create_branch(uint32_t confluence);
+	template <typename Visitor>
+	void visit_branches(const DrainageBasin &basin, Visitor visitor);
 private:
 	void clear();
+	void resize_maps(int resolution);
+	void create_tiles();
 private: // relief stuff
 	void floodfill_relief(unsigned max_size, ReliefType target, ReliefType replacement);
 	void remove_echoriads();
 	void mark_islands(unsigned max_size);
+	void find_water(const TileComponents &components, std::vector<bool> &found_water) const;
 	void mark_coasts();
 	void mark_walls();
 private: // river stuff
@@ -147,6 +223,7 @@ private: // image maps adjustments
 	void create_reliefmap(int seed);
 	void form_base_relief();
 	void form_mountain_ridges();
+	void draw_river_mask();
 	void river_cut_relief();
 };
 
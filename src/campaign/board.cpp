@@ -4,8 +4,10 @@
 #include <memory>
 #include <list>
 #include <queue>
+#ifndef CAMPAIGN_HEADLESS
 #include <GL/glew.h>
 #include <GL/gl.h>
+#endif
 #include <glm/vec3.hpp>
 #include <glm/vec4.hpp>
 #include <glm/mat4x4.hpp>
@@ -17,17 +19,23 @@
 #include "../util/camera.h"
 #include "../util/navigation.h"
 #include "../util/image.h"
+#include "../util/heightpyramid.h"
+#ifndef CAMPAIGN_HEADLESS
 #include "../graphics/mesh.h"
 #include "../graphics/shader.h"
 #include "../graphics/texture.h"
+#endif
 #include "../physics/physical.h"
 #include "../physics/heightfield.h"
 
 #include "atlas.h"
+#include "boardcache.h"
+#include "routeplanner.h"
 #include "board.h"
 
 #define INT_CEIL(n,d) (int)ceil((float)n/d)
 	
+#ifndef CAMPAIGN_HEADLESS
 void BoardModel::paint_political_triangle(const glm::vec2 &a, const glm::vec2 &b, const glm::vec2 &c, const glm::vec3 &color, float alpha)
 {
 	std::vector<glm::ivec2> pixels;
@@ -45,7 +53,7 @@ void BoardModel::paint_political_line(const glm::vec2 &a, const glm::vec2 &b, ui
 	m_political_boundaries.draw_thick_line_relative(a, b, 2, util::CHANNEL_RED, color);
 }
 
-BoardModel::BoardModel(std::shared_ptr<gfx::Shader> shader, std::shared_ptr<gfx::Shader> blur_shader, const util::Image<float> &heightmap, const util::Image<float> &normalmap)
+BoardModel::BoardModel(std::shared_ptr<gfx::Shader> shader, std::shared_ptr<gfx::Shader> blur_shader, const util::Image<float> &heightmap, const util::Image<uint8_t> &normalmap)
 	: m_shader(shader), m_blur_shader(blur_shader)
 {
 	m_border_map.resize(2048, 2048, util::COLORSPACE_GRAYSCALE);
@@ -121,7 +129,7 @@ void BoardModel::reload(const Atlas &atlas)
 			m_border_map.draw_line_relative(a, b, util::CHANNEL_RED, 255);
 		}
 	}
-	m_border_map.blur(1.f);
+	m_border_map.blur(1.f, m_blur_scratch);
 
 	m_heightmap.reload(atlas.heightmap());
 	m_normalmap.reload(atlas.normalmap());
@@ -202,57 +210,113 @@ void BoardModel::set_border_mix(float mix)
 }
 	
 Board::Board(std::shared_ptr<gfx::Shader> tilemap, std::shared_ptr<gfx::Shader> blur_shader)
-	: m_model(tilemap, blur_shader, m_atlas.heightmap(), m_atlas.normalmap())
+	: Board()
+{
+	m_model = std::make_unique<BoardModel>(tilemap, blur_shader, m_atlas.heightmap(), m_atlas.normalmap());
+}
+#endif
+	
+Board::Board()
 {
 	m_height_field = std::make_unique<fysx::HeightField>(m_atlas.heightmap(), scale);
+	m_height_pyramid.build(m_atlas.heightmap(), util::CHANNEL_RED, scale);
 }
 	
-void Board::generate(int seed, const AtlasParameters& atlas_params)
+bool Board::generate(int seed, const AtlasParameters& atlas_params, util::Progress *progress)
 {
+	// navigation is one more stage after the atlas
+	if (progress) {
+		progress->add_stages(1);
+	}
+
 	const geom::Rectangle bounds = { { 0.F, 0.F }, { scale.x, scale.z } };
+
+	// the same world has been generated before
+	const BoardCache cache(cache_directory);
+	const uint64_t key = BoardCache::key(seed, bounds, atlas_params);
+	if (!cache_directory.empty() && cache.load(key, m_atlas, m_land_navigation)) {
+		m_route_planner.build(m_atlas);
+		if (progress) {
+			progress->finish_stage("cache");
+		}
+		return true;
+	}
+
 	//AtlasParameters parameters = {};
 	//parameters.tile_count = tile_count;
-	m_atlas.generate(seed, bounds, atlas_params);
+	if (!m_atlas.generate(seed, bounds, atlas_params, progress)) {
+		return false;
+	}
 	
 	build_navigation();
+	m_route_planner.build(m_atlas);
+
+	if (!cache_directory.empty()) {
+		cache.store(key, m_atlas, m_land_navigation);
+	}
+
+	if (progress) {
+		progress->finish_stage("navigation");
+	}
+
+	return true;
 }
 	
 void Board::reload()
 {
 	m_height_field = std::make_unique<fysx::HeightField>(m_atlas.heightmap(), scale);
+	m_height_pyramid.build(m_atlas.heightmap(), util::CHANNEL_RED, scale);
+
+#ifndef CAMPAIGN_HEADLESS
+	// the rest is only needed to render the board
+	if (!m_model) {
+		return;
+	}
 
 	// world normalmap from heightmap
 	m_atlas.create_normalmap();
 	
-	m_model.reload(m_atlas);
-	m_model.set_scale(scale);
+	m_model->reload(m_atlas);
+	m_model->set_scale(scale);
+#endif
 }
 	
 void Board::paint_tile(uint32_t tile, const glm::vec3 &color, float alpha)
 {
+	// nothing would ever paint the jobs
+	if (headless()) {
+		return;
+	}
+
 	TilePaintJob job = { tile, color, alpha };
 	m_paint_jobs.push(job);
 }
 
 void Board::paint_border(uint32_t border, uint8_t color)
 {
+	if (headless()) {
+		return;
+	}
+
 	BorderPaintJob job = { border, color };
 	m_border_paint_jobs.push(job);
 }
 
+#ifndef CAMPAIGN_HEADLESS
 void Board::display(const util::Camera &camera)
 {
-	m_model.display(camera);
+	m_model->display(camera);
 }
 
 void Board::display_wireframe(const util::Camera &camera)
 {
 	glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 
-	m_model.display(camera);
+	m_model->display(camera);
 
 	glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
 }
+#endif
 	
 fysx::HeightField* Board::height_field()
 {
@@ -274,13 +338,37 @@ glm::vec2 Board::tile_center(uint32_t index) const
 	return m_atlas.tile_center(index);
 }
 	
-void Board::find_path(const glm::vec2 &start, const glm::vec2 &end, std::list<glm::vec2> &path) const
+RouteLeg Board::find_path(const glm::vec2 &start, const glm::vec2 &end, std::list<glm::vec2> &path) const
 {
-	m_land_navigation.find_2D_path(start, end, path);
+	glm::vec2 waypoint = end;
+	RouteLeg leg = route_leg(start, end, waypoint);
+	if (leg != RouteLeg::UNREACHABLE) {
+		m_land_navigation.find_2D_path(start, waypoint, path);
+	}
+
+	return leg;
+}
+	
+RouteLeg Board::route_leg(const glm::vec2 &start, const glm::vec2 &end, glm::vec2 &waypoint) const
+{
+	waypoint = end;
+
+	const Tile *start_tile = m_atlas.tile_at(start);
+	const Tile *end_tile = m_atlas.tile_at(end);
+	if (!start_tile || !end_tile) {
+		return RouteLeg::DIRECT;
+	}
+
+	return m_route_planner.next_leg(start_tile->index, end_tile->index, waypoint);
 }
 	
 void Board::update()
 {
+#ifndef CAMPAIGN_HEADLESS
+	if (!m_model) {
+		return;
+	}
+
 	const auto &tiles = m_atlas.tiles();
 	const auto &borders = m_atlas.borders();
 	const auto &graph = m_atlas.graph();
@@ -301,7 +389,7 @@ void Board::update()
 				const auto &right_vertex = edge->right_vertex;
 				glm::vec2 a = left_vertex->position / bounds.max;
 				glm::vec2 b = right_vertex->position / bounds.max;
-				m_model.paint_political_triangle(a, b, center, order.color, order.alpha);
+				m_model->paint_political_triangle(a, b, center, order.color, order.alpha);
 			}
 			m_paint_jobs.pop();
 		}
@@ -318,7 +406,7 @@ void Board::update()
 			const auto &right_vertex = edge.right_vertex;
 			glm::vec2 a = left_vertex->position / bounds.max;
 			glm::vec2 b = right_vertex->position / bounds.max;
-			m_model.paint_political_line(a, b, order.color);
+			m_model->paint_political_line(a, b, order.color);
 			m_border_paint_jobs.pop();
 		}
 		update_model = true;
@@ -326,8 +414,9 @@ void Board::update()
 
 	// tile colors have been changed, update mesh
 	if (update_model) {
-		m_model.update();
+		m_model->update();
 	}
+#endif
 }
 	
 void Board::build_navigation()
@@ -386,16 +475,28 @@ void Board::build_navigation()
 
 void Board::set_marker(const BoardMarker &marker)
 {
-	m_model.set_marker(marker);
+#ifndef CAMPAIGN_HEADLESS
+	if (m_model) {
+		m_model->set_marker(marker);
+	}
+#endif
 }
 
 void Board::hide_marker()
 {
-	m_model.hide_marker();
+#ifndef CAMPAIGN_HEADLESS
+	if (m_model) {
+		m_model->hide_marker();
+	}
+#endif
 }
 
 void Board::set_border_mix(float mix)
 {
-	m_model.set_border_mix(mix);
+#ifndef CAMPAIGN_HEADLESS
+	if (m_model) {
+		m_model->set_border_mix(mix);
+	}
+#endif
 }
 	
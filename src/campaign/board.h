@@ -6,9 +6,10 @@ struct BoardMarker {
 	float fade = 1.f; // transparancy, keep this between 0 and 1
 };
 
+#ifndef CAMPAIGN_HEADLESS
 class BoardModel {
 public:
-	BoardModel(std::shared_ptr<gfx::Shader> shader, std::shared_ptr<gfx::Shader> blur_shader, const util::Image<float> &heightmap, const util::Image<float> &normalmap);
+	BoardModel(std::shared_ptr<gfx::Shader> shader, std::shared_ptr<gfx::Shader> blur_shader, const util::Image<float> &heightmap, const util::Image<uint8_t> &normalmap);
 public:
 	void set_scale(const glm::vec3 &scale);
 	void add_material(const std::string &name, const gfx::Texture *texture);
@@ -35,6 +36,7 @@ private:
 	std::unordered_map<std::string, const gfx::Texture*> m_materials;
 private:
 	util::Image<uint8_t> m_border_map;
+	util::BlurScratch<uint8_t> m_blur_scratch;
 	gfx::Texture m_border_texture;
 	float m_border_mix = 0.f;
 private:
@@ -49,6 +51,7 @@ private:
 	BoardMarker m_marker = {};
 	bool m_marker_visible = false;
 };
+#endif
 
 struct TilePaintJob {
 	uint32_t tile;
@@ -63,11 +66,17 @@ struct BorderPaintJob {
 
 class Board {
 public:
+#ifndef CAMPAIGN_HEADLESS
 	Board(std::shared_ptr<gfx::Shader> tilemap, std::shared_ptr<gfx::Shader> blur_shader);
+#endif
+	Board(); // headless, without a model so it never touches GL
 public:
 	glm::vec3 scale = { 1024.f, 64.f, 1024.f };
+	std::string cache_directory = {}; // generated boards are cached here, empty to always generate
 public:
-	void generate(int seed, const AtlasParameters& atlas_params);
+	// only touches the atlas and navigation so it can run on a worker thread, reload has to follow on the main thread
+	// returns false if the progress was cancelled
+	bool generate(int seed, const AtlasParameters& atlas_params, util::Progress *progress = nullptr);
 	void reload();
 	void update();
 	void paint_tile(uint32_t tile, const glm::vec3 &color, float alpha);
@@ -78,13 +87,22 @@ public:
 	void set_border_mix(float mix);
 public:
 	fysx::HeightField* height_field();
+	const util::HeightPyramid& height_pyramid() const { return m_height_pyramid; }
 	const util::Navigation& navigation() const;
 	const Atlas& atlas() const { return m_atlas; }
 	Atlas& atlas() { return m_atlas; }
-	BoardModel& model() { return m_model; }
+#ifndef CAMPAIGN_HEADLESS
+	BoardModel& model() { return *m_model; }
+	bool headless() const { return !m_model; }
+#else
+	bool headless() const { return true; }
+#endif
 	const Tile* tile_at(const glm::vec2 &position) const;
 	glm::vec2 tile_center(uint32_t index) const;
-	void find_path(const glm::vec2 &start, const glm::vec2 &end, std::list<glm::vec2> &path) const;
+	// long routes are found a few clusters at a time, a partial path ends at the first waypoint of the route
+	RouteLeg find_path(const glm::vec2 &start, const glm::vec2 &end, std::list<glm::vec2> &path) const;
+	// the end of the path that should be found next, the end itself unless the route is partial
+	RouteLeg route_leg(const glm::vec2 &start, const glm::vec2 &end, glm::vec2 &waypoint) const;
 public:
 	template <class Archive>
 	void save(Archive &archive) const
@@ -96,15 +114,22 @@ public:
 	void load(Archive &archive)
 	{
 		archive(m_atlas, m_land_navigation);
+		m_route_planner.build(m_atlas);
 	}
+#ifndef CAMPAIGN_HEADLESS
 public:
 	void display(const util::Camera &camera);
 	void display_wireframe(const util::Camera &camera);
+#endif
 private:
 	Atlas m_atlas;
-	BoardModel m_model;
+#ifndef CAMPAIGN_HEADLESS
+	std::unique_ptr<BoardModel> m_model;
+#endif
 	std::unique_ptr<fysx::HeightField> m_height_field;
+	util::HeightPyramid m_height_pyramid; // height and ray queries without the physics world
 	util::Navigation m_land_navigation;
+	RoutePlanner m_route_planner;
 private:
 	std::queue<TilePaintJob> m_paint_jobs;
 	std::queue<BorderPaintJob> m_border_paint_jobs;
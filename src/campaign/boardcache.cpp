@@ -0,0 +1,221 @@
+#include <vector>
+#include <string>
+#include <fstream>
+#include <filesystem>
+#include <list>
+#include <queue>
+#include <limits>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <glm/mat4x4.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "../extern/cereal/archives/binary.hpp"
+
+#include "../geometry/geometry.h"
+#include "../geometry/voronoi.h"
+#include "../util/logger.h"
+#include "../util/serialize.h"
+#include "../util/image.h"
+#include "../util/navigation.h"
+
+#include "atlas.h"
+#include "boardcache.h"
+
+static const uint32_t CACHE_MAGIC = 0x4452424e; // "NBRD"
+static const uint32_t CACHE_FORMAT = 2; // change if the layout of the file changes
+static const uint64_t SECTION_ALIGNMENT = 64;
+
+// FNV-1a
+class KeyHasher {
+public:
+	template <typename T>
+	void feed(const T &value)
+	{
+		const uint8_t *bytes = reinterpret_cast<const uint8_t*>(&value);
+		for (size_t i = 0; i < sizeof(T); i++) {
+			m_hash ^= bytes[i];
+			m_hash *= 1099511628211ULL;
+		}
+	}
+	uint64_t hash() const { return m_hash; }
+private:
+	uint64_t m_hash = 14695981039346656037ULL;
+};
+
+static void pad_to_alignment(std::ofstream &stream)
+{
+	const uint64_t position = stream.tellp();
+	const uint64_t padding = (SECTION_ALIGNMENT - position % SECTION_ALIGNMENT) % SECTION_ALIGNMENT;
+	for (uint64_t i = 0; i < padding; i++) {
+		stream.put(0);
+	}
+}
+
+BoardCache::BoardCache(const std::string &directory)
+	: m_directory(directory)
+{
+}
+
+uint64_t BoardCache::key(int seed, const geom::Rectangle &bounds, const AtlasParameters &parameters)
+{
+	KeyHasher hasher;
+
+	hasher.feed(CACHE_FORMAT);
+	hasher.feed(ATLAS_GENERATOR_VERSION);
+	hasher.feed(seed);
+	hasher.feed(bounds.min.x);
+	hasher.feed(bounds.min.y);
+	hasher.feed(bounds.max.x);
+	hasher.feed(bounds.max.y);
+
+	// field by field so padding never ends up in the key
+	hasher.feed(parameters.tile_count);
+	hasher.feed(parameters.resolution);
+	hasher.feed(parameters.lowland);
+	hasher.feed(parameters.hills);
+	hasher.feed(parameters.mountains);
+	hasher.feed(parameters.noise_frequency);
+	hasher.feed(parameters.noise_octaves);
+	hasher.feed(parameters.noise_lacunarity);
+	hasher.feed(parameters.perturb_frequency);
+	hasher.feed(parameters.perturb_amp);
+	hasher.feed(parameters.erosion_iterations);
+	hasher.feed(parameters.erosion_resolution);
+
+	return hasher.hash();
+}
+
+std::string BoardCache::filepath(uint64_t key) const
+{
+	return m_directory + fmt::format("{:016x}.board", key);
+}
+
+bool BoardCache::load(uint64_t key, Atlas &atlas, util::Navigation &navigation) const
+{
+	const std::string path = filepath(key);
+
+	std::ifstream stream(path, std::ios::binary);
+	if (!stream.is_open()) {
+		return false; // not cached yet
+	}
+
+	std::error_code error;
+	const uint64_t file_size = std::filesystem::file_size(path, error);
+
+	BoardCacheHeader header;
+	stream.read(reinterpret_cast<char*>(&header), sizeof(header));
+	if (error || !stream || header.magic != CACHE_MAGIC || header.format != CACHE_FORMAT || header.key != key) {
+		logger::ERROR("Board cache error: {} is not a valid cache file", path);
+		return false;
+	}
+
+	for (const auto &section : { header.heightmap, header.atlas, header.navigation }) {
+		// compared without the sum so a damaged section can not wrap around
+		if (section.offset > file_size || section.size > file_size - section.offset) {
+			logger::ERROR("Board cache error: {} is truncated", path);
+			return false;
+		}
+	}
+
+	// the image can not be larger than this, resize would truncate it and the raster would be too small to read into
+	const int32_t max_side = std::numeric_limits<uint16_t>::max();
+	if (header.width <= 0 || header.height <= 0 || header.width > max_side || header.height > max_side || header.channels != util::COLORSPACE_GRAYSCALE) {
+		logger::ERROR("Board cache error: {} has a height map of an invalid size", path);
+		return false;
+	}
+
+	auto &heightmap = atlas.heightmap();
+	const uint64_t heightmap_size = uint64_t(header.width) * header.height * header.channels * sizeof(float);
+	if (header.heightmap.size != heightmap_size) {
+		logger::ERROR("Board cache error: {} has a height map of the wrong size", path);
+		return false;
+	}
+	heightmap.resize(header.width, header.height, header.channels);
+	stream.seekg(header.heightmap.offset);
+	stream.read(reinterpret_cast<char*>(heightmap.raster().data()), heightmap_size);
+
+	// cereal throws if the data is corrupt
+	try {
+		stream.seekg(header.atlas.offset);
+		{
+			cereal::BinaryInputArchive archive(stream);
+			atlas.load_topology(archive);
+		}
+		stream.seekg(header.navigation.offset);
+		{
+			cereal::BinaryInputArchive archive(stream);
+			navigation.load(archive);
+		}
+	} catch (const std::exception &exception) {
+		logger::ERROR("Board cache error: could not read {}: {}", path, exception.what());
+		return false;
+	}
+
+	return bool(stream);
+}
+
+bool BoardCache::store(uint64_t key, const Atlas &atlas, const util::Navigation &navigation) const
+{
+	const std::string path = filepath(key);
+	// written under another name first so a half written file is never loaded
+	const std::string temporary = path + ".tmp";
+
+	std::ofstream stream(temporary, std::ios::binary);
+	if (!stream.is_open()) {
+		logger::ERROR("Board cache error: could not write {}", temporary);
+		return false;
+	}
+
+	const auto &heightmap = atlas.heightmap();
+
+	BoardCacheHeader header;
+	header.magic = CACHE_MAGIC;
+	header.format = CACHE_FORMAT;
+	header.key = key;
+	header.width = heightmap.width();
+	header.height = heightmap.height();
+	header.channels = heightmap.channels();
+
+	// the section table is only known at the end so the header is written again
+	stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+	pad_to_alignment(stream);
+	header.heightmap.offset = stream.tellp();
+	stream.write(reinterpret_cast<const char*>(heightmap.raster().data()), heightmap.raster().size() * sizeof(float));
+	header.heightmap.size = uint64_t(stream.tellp()) - header.heightmap.offset;
+
+	pad_to_alignment(stream);
+	header.atlas.offset = stream.tellp();
+	{
+		cereal::BinaryOutputArchive archive(stream);
+		atlas.save_topology(archive);
+	}
+	header.atlas.size = uint64_t(stream.tellp()) - header.atlas.offset;
+
+	pad_to_alignment(stream);
+	header.navigation.offset = stream.tellp();
+	{
+		cereal::BinaryOutputArchive archive(stream);
+		navigation.save(archive);
+	}
+	header.navigation.size = uint64_t(stream.tellp()) - header.navigation.offset;
+
+	stream.seekp(0);
+	stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	stream.close();
+
+	if (!stream) {
+		logger::ERROR("Board cache error: could not write {}", temporary);
+		return false;
+	}
+
+	std::error_code error;
+	std::filesystem::rename(temporary, path, error);
+	if (error) {
+		logger::ERROR("Board cache error: could not move {} to {}: {}", temporary, path, error.message());
+		return false;
+	}
+
+	return true;
+}
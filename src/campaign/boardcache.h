@@ -0,0 +1,37 @@
+
+struct BoardCacheSection {
+	uint64_t offset = 0; // from the start of the file
+	uint64_t size = 0; // in bytes
+};
+
+// fixed size header at the start of every cache file
+struct BoardCacheHeader {
+	uint32_t magic = 0;
+	uint32_t format = 0;
+	uint64_t key = 0;
+	int32_t width = 0; // height map size
+	int32_t height = 0;
+	int32_t channels = 0;
+	int32_t padding = 0;
+	BoardCacheSection heightmap; // raw floats
+	BoardCacheSection atlas; // tiles and graph, cereal binary
+	BoardCacheSection navigation; // navigation mesh record, cereal binary
+};
+
+// on disk cache of generated boards
+// generating a board is deterministic, the result only depends on the seed, the bounds, the atlas parameters and the generator version
+// so every board is stored in its own file named after a hash of those
+// each section starts on a 64 byte boundary so the file can be mapped into memory as is
+class BoardCache {
+public:
+	BoardCache(const std::string &directory);
+public:
+	static uint64_t key(int seed, const geom::Rectangle &bounds, const AtlasParameters &parameters);
+	std::string filepath(uint64_t key) const;
+public:
+	// returns false if the board is not in the cache
+	bool load(uint64_t key, Atlas &atlas, util::Navigation &navigation) const;
+	bool store(uint64_t key, const Atlas &atlas, const util::Navigation &navigation) const;
+private:
+	std::string m_directory;
+};
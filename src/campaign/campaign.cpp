@@ -6,14 +6,19 @@
 #include <queue>
 #include <random>
 #include <fstream>
+#include <thread>
+#ifndef CAMPAIGN_HEADLESS
 #include <SDL2/SDL.h>
 #include <GL/glew.h>
 #include <GL/gl.h>
+#endif
 
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#ifndef CAMPAIGN_HEADLESS
 #include "../extern/imgui/imgui.h"
+#endif
 
 #include "../extern/cereal/archives/binary.hpp"
 #include "../extern/cereal/archives/json.hpp"
@@ -22,29 +27,38 @@
 
 #include "../util/logger.h"
 #include "../util/serialize.h"
+#include "../util/slotmap.h"
 #include "../util/config.h"
+#ifndef CAMPAIGN_HEADLESS
 #include "../util/input.h"
+#endif
 #include "../util/camera.h"
 #include "../util/timer.h"
 #include "../util/navigation.h"
+#include "../util/pathservice.h"
 #include "../util/animation.h"
 #include "../geometry/geometry.h"
 #include "../geometry/transform.h"
 #include "../geometry/voronoi.h"
 #include "../util/image.h"
+#include "../util/heightpyramid.h"
+#ifndef CAMPAIGN_HEADLESS
 #include "../graphics/shader.h"
 #include "../graphics/mesh.h"
 #include "../graphics/model.h"
 #include "../graphics/texture.h"
 #include "../graphics/scene.h"
 #include "../graphics/font.h"
+#endif
 #include "../physics/physical.h"
 #include "../physics/heightfield.h"
 #include "../physics/trigger.h"
 
+#ifndef CAMPAIGN_HEADLESS
 #include "../debugger.h"
 #include "../media.h"
 #include "../module.h"
+#endif
 #include "../console.h"
 
 #include "campaign.h"
@@ -67,7 +81,19 @@ enum class CampaignEntityType : uint8_t {
 };
 
 static const float GAME_TIME_SLICE = 1.f; // in seconds time needed to update game tick
+static const int GAME_TICK_STEPS = 8; // fixed world steps in a game tick when simulating
+static const size_t PATHS_PER_FRAME = 32; // the rest of the found paths wait for the next frame
 
+Campaign::~Campaign()
+{
+	// quitting during a generation should not wait for the whole world
+	if (m_generation.valid()) {
+		cancel_generation();
+		m_generation.wait();
+	}
+}
+
+#ifndef CAMPAIGN_HEADLESS
 // initializes the campaign
 void Campaign::init(const gfx::ShaderGroup *shaders)
 {
@@ -82,7 +108,14 @@ void Campaign::init(const gfx::ShaderGroup *shaders)
 	font_shader = shaders->font;
 	label_shader = shaders->label;
 }
+#endif
+	
+void Campaign::init_headless()
+{
+	board = std::make_unique<Board>();
+}
 	
+#ifndef CAMPAIGN_HEADLESS
 // load campaign bueprints from the module
 void Campaign::load_blueprints(const Module &module)
 {
@@ -112,6 +145,7 @@ void Campaign::load_blueprints(const Module &module)
 		board_model.add_material(material.shader_name, MediaManager::load_texture(material.texture_path));
 	}
 }
+#endif
 	
 // loads a campaign save game
 void Campaign::load(const std::string &filepath)
@@ -128,6 +162,11 @@ void Campaign::load(const std::string &filepath)
 		archive(meeple_controller.meeples);
 		archive(faction_controller);
 		archive(settlement_controller);
+		// the per tile arrays are indexed by tile, a save of another board would read past them
+		const size_t tile_count = board->atlas().tiles().size();
+		if (faction_controller.tile_owners.size() != tile_count || settlement_controller.tile_owners.size() != tile_count) {
+			throw cereal::Exception("tile arrays do not match the board");
+		}
 		archive(player_data);
 		archive(game_ticks);
 		archive(faction_ticks);
@@ -162,6 +201,24 @@ void Campaign::save(const std::string &filepath)
 // generates a new campaign world based on a seed
 void Campaign::generate(const CampaignGenParams& gen_params)
 {
+	start_generation(gen_params);
+
+	finish_generation();
+}
+
+void Campaign::start_generation(const CampaignGenParams& gen_params)
+{
+	// only one generation at a time
+	if (m_generation.valid()) {
+		cancel_generation();
+		m_generation.wait();
+	}
+
+	// the navigation is rebuilt
+	m_paths.stop();
+
+	m_gen_params = gen_params;
+
 	// reset game ticks
 	game_ticks = 0;
 	faction_ticks = 0;
@@ -175,15 +232,43 @@ void Campaign::generate(const CampaignGenParams& gen_params)
 	board->scale.x = gen_params.map_size;
 	board->scale.y = 48.f;
 	board->scale.z = gen_params.map_size;
-	board->generate(seed, gen_params.atlas);
+	board->cache_directory = gen_params.cache_directory;
+
+	// the board stays untouched by the main thread until the generation is finished
+	m_generation_progress.reset();
+	m_generation = std::async(std::launch::async, [this]() {
+		return board->generate(seed, m_gen_params.atlas, &m_generation_progress);
+	});
+}
+
+bool Campaign::generation_ready() const
+{
+	return m_generation.valid() && m_generation.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+void Campaign::cancel_generation()
+{
+	m_generation_progress.cancel();
+}
+
+bool Campaign::finish_generation()
+{
+	if (!m_generation.valid()) {
+		return false;
+	}
+
+	// blocks if the board is not ready yet
+	if (!m_generation.get()) {
+		return false;
+	}
+
+	const auto &gen_params = m_gen_params;
 
 	// set a new clean state for game data
 	const auto &atlas = board->atlas();	
 	const auto &tiles = atlas.tiles();	
-	for (const auto &tile : tiles) {
-		faction_controller.tile_owners[tile.index] = 0;
-		settlement_controller.tile_owners[tile.index] = 0;
-	}
+	faction_controller.tile_owners.assign(tiles.size(), 0);
+	settlement_controller.tile_owners.assign(tiles.size(), 0);
 
 	// find ideal places to settle towns in our generated world
 	faction_controller.find_town_targets(atlas, 5);
@@ -197,27 +282,27 @@ void Campaign::generate(const CampaignGenParams& gen_params)
 	spawn_barbarians();
 
 	// assign player data
-	player_data.meeple_id = id_generator.generate();
-	meeple_controller.meeples[player_data.meeple_id] = std::make_unique<Meeple>();
-	meeple_controller.player = meeple_controller.meeples[player_data.meeple_id].get();
-	meeple_controller.player->id = player_data.meeple_id;
-	meeple_controller.player->set_speed(4.f);
-	meeple_controller.player->faction_id = player_data.faction_id;
-	meeple_controller.player->control_type = MeepleControlType::PLAYER;
-	meeple_controller.player->troop_count = 15;
+	player_data.meeple_id = meeple_controller.meeples.emplace();
+	meeple_controller.player_id = player_data.meeple_id;
+	meeple_controller.player()->id = player_data.meeple_id;
+	meeple_controller.player()->set_speed(4.f);
+	meeple_controller.player()->faction_id = player_data.faction_id;
+	meeple_controller.player()->control_type = MeepleControlType::PLAYER;
+	meeple_controller.player()->troop_count = 15;
 
 	// position meeples at faction capitals
-	for (auto &mapping : meeple_controller.meeples) {
-		auto &meeple = mapping.second;
-		auto faction_search = faction_controller.factions.find(meeple->faction_id);
+	for (auto &meeple : meeple_controller.meeples) {
+		auto faction_search = faction_controller.factions.find(meeple.faction_id);
 		if (faction_search != faction_controller.factions.end()) {
-			auto town_search = settlement_controller.towns.find(faction_search->second->capital_id);
-			if (town_search != settlement_controller.towns.end()) {
-				glm::vec2 center = board->tile_center(town_search->second->tile);
-				meeple->teleport(center);
+			auto *capital = settlement_controller.towns.find(faction_search->second->capital_id);
+			if (capital) {
+				glm::vec2 center = board->tile_center(capital->tile);
+				meeple.teleport(center);
 			}
 		}
 	}
+
+	return true;
 }
 	
 // prepares a new or loaded campaign
@@ -233,7 +318,7 @@ void Campaign::prepare()
 
 	// place towns
 	for (auto &town : settlement_controller.towns) {
-		place_town(town.second.get());
+		place_town(&town);
 	}
 
 	const auto &atlas = board->atlas();	
@@ -265,17 +350,29 @@ void Campaign::prepare()
 	board->update();
 
 	// place meeples
-	meeple_controller.player = meeple_controller.meeples[player_data.meeple_id].get();
-	for (auto &mapping : meeple_controller.meeples) {
-		auto &meeple = mapping.second;
-		// set animations TODO should be done earlier during object construction
-		meeple->set_animation(army_blueprint.anim_set.get());
-		meeple->sync();
-		place_meeple(meeple.get());
-		meeple->update_animation(0.01f); // initial pose
+	meeple_controller.player_id = player_data.meeple_id;
+	for (auto &meeple : meeple_controller.meeples) {
+		meeple.sync();
+		place_meeple(&meeple);
+#ifndef CAMPAIGN_HEADLESS
+		if (!board->headless()) {
+			// set animations TODO should be done earlier during object construction
+			meeple.set_animation(army_blueprint.anim_set.get());
+			meeple.update_animation(0.01f); // initial pose
+		}
+#endif
 	}
 	
-	debugger->add_navmesh(board->navigation().navmesh());
+#ifndef CAMPAIGN_HEADLESS
+	if (debugger) {
+		debugger->add_navmesh(board->navigation().navmesh());
+	}
+#endif
+
+	m_random.seed(seed);
+
+	// leave a core for the main thread
+	m_paths.start(&board->navigation(), int(std::thread::hardware_concurrency()) - 1);
 
 	// game is paused at the start
 	state = CampaignState::PAUSED;
@@ -291,7 +388,20 @@ void Campaign::prepare()
 // clears all the campaign data
 void Campaign::clear()
 {
-	debugger->clear();
+	// stop a generation that is still running
+	if (m_generation.valid()) {
+		cancel_generation();
+		m_generation.wait();
+		m_generation = {};
+	}
+
+#ifndef CAMPAIGN_HEADLESS
+	if (debugger) {
+		debugger->clear();
+	}
+#endif
+
+	m_paths.stop();
 
 	// clear physical objects
 	physics.clear_objects();
@@ -304,6 +414,7 @@ void Campaign::clear()
 	settlement_controller.clear();
 }
 
+#ifndef CAMPAIGN_HEADLESS
 // the campaign game update in a frame
 void Campaign::update(float delta)
 {
@@ -324,30 +435,27 @@ void Campaign::update(float delta)
 			
 		if (town_prompt.choice == TownPromptChoice::REST) {
 			choice_made = true;
-			auto search = settlement_controller.towns.find(meeple_controller.player->target_id);
-			if (search != settlement_controller.towns.end()) {
-				const auto &town = search->second;
-				station_meeple(meeple_controller.player, town.get());
-				meeple_controller.player->clear_target();
+			auto *town = settlement_controller.towns.find(meeple_controller.player()->target_id);
+			if (town) {
+				station_meeple(meeple_controller.player(), town);
+				meeple_controller.player()->clear_target();
 			}
 		} else if (town_prompt.choice == TownPromptChoice::VISIT) {
 			choice_made = true;
-			auto search = settlement_controller.towns.find(meeple_controller.player->target_id);
-			if (search != settlement_controller.towns.end()) {
-				const auto &town = search->second;
+			auto *town = settlement_controller.towns.find(meeple_controller.player()->target_id);
+			if (town) {
 				battle_data.tile = town->tile;
 				battle_data.town_size = town->size;
 				battle_data.walled = town->walled;
-				meeple_controller.player->clear_target();
+				meeple_controller.player()->clear_target();
 			}
 		} else if (town_prompt.choice == TownPromptChoice::BESIEGE) {
 			choice_made = true;
-			auto search = settlement_controller.towns.find(meeple_controller.player->target_id);
-			if (search != settlement_controller.towns.end()) {
-				const auto &town = search->second;
-				transfer_town(town.get(), meeple_controller.player->faction_id);
-				station_meeple(meeple_controller.player, town.get());
-				meeple_controller.player->clear_target();
+			auto *town = settlement_controller.towns.find(meeple_controller.player()->target_id);
+			if (town) {
+				transfer_town(town, meeple_controller.player()->faction_id);
+				station_meeple(meeple_controller.player(), town);
+				meeple_controller.player()->clear_target();
 			}
 		}
 
@@ -372,21 +480,8 @@ void Campaign::update(float delta)
 		// new game tick
 		if (hourglass_sand > GAME_TIME_SLICE) {
 			float integral = floorf(hourglass_sand);
-			game_ticks += integral;
-			// set internal entity ticks
-			meeple_controller.add_ticks(integral);
 			hourglass_sand -= integral; // reset plus fractional part
-			// do updates that should only happen once per tick update
-			for (auto &mapping : meeple_controller.meeples) {
-				auto &meeple = mapping.second;
-				update_meeple_behavior(meeple.get());
-			}
-			update_meeple_paths();
-			// update town gameplay
-			for (auto &mapping : settlement_controller.towns) {
-				auto &town = mapping.second;
-				update_town_tick(town.get(), integral);
-			}
+			advance_ticks(integral);
 		}
 	}
 
@@ -411,43 +506,18 @@ void Campaign::update(float delta)
 	}
 
 	// if the game isn't paused update gameplay
-	std::random_device rd;
-	std::mt19937 gen(rd());
-	std::uniform_real_distribution<float> distrib(-1.f, 1.f);
-	std::uniform_real_distribution<float> distance_distrib(100.f, 300.f);
-
 	if (state == CampaignState::RUNNING) {
-		update_factions();
-		meeple_controller.update(delta);
-		// roaming on map
-		for (auto &mapping : meeple_controller.meeples) {
-			auto &meeple = mapping.second;
-			if (meeple->control_type == MeepleControlType::AI_BARBARIAN && meeple->behavior_state == MeepleBehavior::PATROL) {
-				if (!meeple->moving) {
-					// go to new random location
-					glm::vec2 direction = { distrib(gen), distrib(gen) };
-					float distance = distance_distrib(gen);
-					glm::vec2 destination = meeple->map_position() + distance * direction;
-					std::list<glm::vec2> nodes;
-					board->find_path(meeple->map_position(), destination, nodes);
-					if (nodes.size()) {
-						meeple->set_path(nodes);
-					}
-				}
-			}
-			update_meeple_target(meeple.get());
-			// vertical offset on map
-			float offset = vertical_offset(meeple->map_position());
-			meeple->set_vertical_offset(offset);
-		
-			meeple->update_animation(delta);
+		deliver_paths(PATHS_PER_FRAME);
+		step_world(delta);
+		for (auto &meeple : meeple_controller.meeples) {
+			meeple.update_animation(delta);
 		}
 	}
 
-	update_marker(meeple_controller.player->target_id, meeple_controller.player->target_type);
+	update_marker(meeple_controller.player()->target_id, meeple_controller.player()->target_type);
 
 	// if player reached the target hide marker
-	if (meeple_controller.player->target_type == 0) {
+	if (meeple_controller.player()->target_type == 0) {
 		board->hide_marker();
 	}
 
@@ -457,7 +527,95 @@ void Campaign::update(float delta)
 	// campaign map paint jobs
 	board->update();
 }
+#endif
+	
+// advances the campaign by a number of game ticks as fast as possible
+// every tick is split in fixed steps so the outcome does not depend on the frame rate
+// there is no input, camera or rendering so this also runs on a headless campaign
+void Campaign::simulate(uint64_t ticks)
+{
+	const float step = GAME_TIME_SLICE / GAME_TICK_STEPS;
+
+	for (uint64_t tick = 0; tick < ticks; tick++) {
+		// every path requested in the previous tick arrives now so runs stay repeatable
+		m_paths.wait_idle();
+		deliver_paths(SIZE_MAX);
+		for (int i = 0; i < GAME_TICK_STEPS; i++) {
+			physics.update_collision_only();
+			step_world(step);
+		}
+		advance_ticks(1);
+	}
+}
+
+// updates that only happen once per game tick
+void Campaign::advance_ticks(uint64_t ticks)
+{
+	game_ticks += ticks;
+	// set internal entity ticks
+	meeple_controller.add_ticks(ticks);
+
+	for (auto &meeple : meeple_controller.meeples) {
+		update_meeple_behavior(&meeple);
+	}
+	update_meeple_paths();
+
+	// update town gameplay
+	for (auto &town : settlement_controller.towns) {
+		update_town_tick(&town, ticks);
+	}
+
+	update_factions();
+}
+
+// moves the meeples on the map
+void Campaign::step_world(float delta)
+{
+	std::uniform_real_distribution<float> distrib(-1.f, 1.f);
+	std::uniform_real_distribution<float> distance_distrib(100.f, 300.f);
+
+	meeple_controller.update(delta);
+	// roaming on map
+	for (auto &meeple : meeple_controller.meeples) {
+		// walked the current leg of a long route
+		if (meeple.long_route && meeple.path_state() == PathState::FINISHED && !m_paths.pending(meeple.id)) {
+			request_path(&meeple, meeple.route_end);
+		}
+		if (meeple.control_type == MeepleControlType::AI_BARBARIAN && meeple.behavior_state == MeepleBehavior::PATROL) {
+			if (meeple.path_state() == PathState::FINISHED && !m_paths.pending(meeple.id)) {
+				// go to new random location
+				glm::vec2 direction = { distrib(m_random), distrib(m_random) };
+				float distance = distance_distrib(m_random);
+				glm::vec2 destination = meeple.map_position() + distance * direction;
+				request_path(&meeple, destination);
+			}
+		}
+		update_meeple_target(&meeple);
+		// vertical offset on map
+		float offset = vertical_offset(meeple.map_position());
+		meeple.set_vertical_offset(offset);
+	}
+}
 	
+// gives the meeples the paths that were found since the last delivery
+void Campaign::deliver_paths(size_t budget)
+{
+	std::vector<util::PathResult> results;
+	m_paths.collect(results, budget);
+
+	for (const auto &result : results) {
+		auto *meeple = meeple_controller.meeples.find(result.requester);
+		if (meeple) {
+			if (result.nodes.size()) {
+				meeple->set_path(result.nodes);
+			} else {
+				meeple->long_route = false; // the rest of the route would fail the same way
+			}
+		}
+	}
+}
+	
+#ifndef CAMPAIGN_HEADLESS
 // renders whatever happens in a campaign
 void Campaign::display()
 {
@@ -470,24 +628,22 @@ void Campaign::display()
 	}
 
 	// display town entities
-	for (auto &mapping : settlement_controller.towns) {
-		auto &town = mapping.second;
-		object_shader->uniform_mat4("MODEL", town->transform.to_matrix());
-		town->model->display();
-		if (town->walled) {
-			town->wall_model->display();
+	for (auto &town : settlement_controller.towns) {
+		object_shader->uniform_mat4("MODEL", town.transform.to_matrix());
+		town.model->display();
+		if (town.walled) {
+			town.wall_model->display();
 		}
 	}
 
 	// display army entities
 	meeple_shader->use();
 	meeple_shader->uniform_mat4("CAMERA_VP", camera.VP);
-	for (auto &mapping : meeple_controller.meeples) {
-		auto &meeple = mapping.second;
+	for (auto &meeple : meeple_controller.meeples) {
 		// only display if visible to player
-		if (meeple->visible) {
-			meeple_shader->uniform_mat4("MODEL", meeple->transform.to_matrix());
-			meeple->display();
+		if (meeple.visible) {
+			meeple_shader->uniform_mat4("MODEL", meeple.transform.to_matrix());
+			meeple.display();
 		}
 	}
 
@@ -500,12 +656,10 @@ void Campaign::display()
 	if (display_debug) {
 		glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 		// display meeple trigger and vision sphere
-		for (auto &mapping : meeple_controller.meeples) {
-
-			auto &meeple = mapping.second;
-			const auto &trigger = meeple->trigger();
+		for (auto &meeple : meeple_controller.meeples) {
+			const auto &trigger = meeple.trigger();
 			debugger->display_sphere(trigger->position(), trigger->radius());
-			const auto &visibility = meeple->visibility();
+			const auto &visibility = meeple.visibility();
 			debugger->display_sphere(visibility->position(), visibility->radius());
 		}
 	
@@ -525,36 +679,30 @@ void Campaign::display_labels()
 	font_shader->uniform_mat4("PROJECT", camera.projection);
 	font_shader->uniform_mat4("VIEW", camera.viewing);
 
-	for (auto &mapping : meeple_controller.meeples) {
-		auto &meeple = mapping.second;
-		if (meeple->visible) {
+	for (auto &meeple : meeple_controller.meeples) {
+		if (meeple.visible) {
 			font_shader->uniform_float("SCALE", 0.02f);
-			font_shader->uniform_vec3("ORIGIN", meeple->transform.position + glm::vec3(0.f, 2.f, 0.f));
+			font_shader->uniform_vec3("ORIGIN", meeple.transform.position + glm::vec3(0.f, 2.f, 0.f));
 			font_shader->uniform_vec3("COLOR", glm::vec3(1.f, 1.f, 0.f));
-			font_manager.display_text("boid " + std::to_string(meeple->id), 0.f, 0.f, 1.f);
+			font_manager.display_text("boid " + std::to_string(meeple.id), 0.f, 0.f, 1.f);
 		}
 	}
 
-	for (auto &mapping : settlement_controller.towns) {
-		auto &town = mapping.second;
+	for (auto &town : settlement_controller.towns) {
 		font_shader->uniform_float("SCALE", 0.05f);
-		font_shader->uniform_vec3("ORIGIN", town->transform.position + glm::vec3(0.f, 2.5f, 0.f));
+		font_shader->uniform_vec3("ORIGIN", town.transform.position + glm::vec3(0.f, 2.5f, 0.f));
 		font_shader->uniform_vec3("COLOR", glm::vec3(1.f, 1.f, 0.f));
-		font_manager.display_text("town " + std::to_string(town->id), 0.f, 0.f, 1.f);
+		font_manager.display_text("town " + std::to_string(town.id), 0.f, 0.f, 1.f);
 	}
 
 	//glEnable(GL_DEPTH_TEST);
 }
+#endif
 	
 // returns the vertical offset of the campaign heightmap at map coordinates
 float Campaign::vertical_offset(const glm::vec2 &position)
 {
-	glm::vec3 origin = { position.x, 2.F * board->scale.y, position.y };
-	glm::vec3 end = { position.x, 0.F, position.y };
-
-	auto result = physics.cast_ray(origin, end, COLLISION_GROUP_HEIGHTMAP);
-	
-	return result.point.y;
+	return board->height_pyramid().height_at(position);
 }
 	
 // places a meeple entity on the campaign map
@@ -637,7 +785,7 @@ void Campaign::spawn_factions(int faction_count)
 		uint32_t id = spawn_town(&tiles[target], faction.get());
 		if (id) {
 			faction->capital_id = id;
-			Town *town = settlement_controller.towns[id].get();
+			Town *town = settlement_controller.towns.find(id);
 			spawn_fiefdom(town);
 		}
 	}
@@ -652,10 +800,9 @@ uint32_t Campaign::spawn_town(const Tile *tile, Faction *faction)
 
 	NameGen::Generator namegen(MIDDLE_EARTH);
 
-	auto search = faction_controller.tile_owners.find(tile->index);
-	if (search == faction_controller.tile_owners.end() || search->second == 0) {
-		std::unique_ptr<Town> town = std::make_unique<Town>();
-		auto id = id_generator.generate();
+	if (faction_controller.tile_owners[tile->index] == 0) {
+		auto id = settlement_controller.towns.emplace();
+		Town *town = settlement_controller.towns.find(id);
 		town->id = id;
 		town->faction = faction->id();
 		town->tile = tile->index;
@@ -667,9 +814,6 @@ uint32_t Campaign::spawn_town(const Tile *tile, Faction *faction)
 		// give town a random name
 		town->name = namegen.toString();
 
-
-		settlement_controller.towns[id] = std::move(town);
-
 		faction_controller.tile_owners[tile->index] = faction->id();
 
 		// add town to faction
@@ -699,7 +843,7 @@ void Campaign::spawn_fiefdom(Town *town)
 
 	// breadth first search
 	const auto &atlas = board->atlas();	
-	const auto &cells = atlas.graph().cells;	
+	const auto &topology = atlas.graph().topology();	
 	const auto &tiles = atlas.tiles();	
 	const auto &borders = atlas.borders();	
 
@@ -719,12 +863,11 @@ void Campaign::spawn_fiefdom(Town *town)
 		fiefdom->add_tile(node);
 		uint32_t layer = depth[node] + 1;
 		if (layer < radius) {
-			const auto &cell = cells[node];
-			for (const auto &edge : cell.edges) {
-				const auto &border = borders[edge->index];
+			for (uint32_t edge : topology.cell_edges[node]) {
+				const auto &border = borders[edge];
 				// if no river is between them
 				if (!(border.flags & BORDER_FLAG_RIVER) && !(border.flags & BORDER_FLAG_FRONTIER)) {
-					auto neighbor_index = edge->left_cell->index == node ? edge->right_cell->index : edge->left_cell->index;
+					auto neighbor_index = topology.opposite_cell(edge, node);
 					const Tile *neighbor = &tiles[neighbor_index];
 					if (walkable_tile(neighbor) && (faction_controller.tile_owners[neighbor->index] == 0)) {
 						depth[neighbor->index] = layer;
@@ -817,10 +960,10 @@ void Campaign::raze_town(Town *town)
 		uint8_t max_size = 0;
 		uint32_t candidate_id = 0;
 		for (const auto &candidate : faction->towns) {
-			auto search = settlement_controller.towns.find(candidate);
-			if (search != settlement_controller.towns.end()) {
-				if (search->second->size > max_size) {
-					max_size = search->second->size;
+			auto *search = settlement_controller.towns.find(candidate);
+			if (search) {
+				if (search->size > max_size) {
+					max_size = search->size;
 					candidate_id = candidate;
 				}
 			}
@@ -837,8 +980,8 @@ void Campaign::raze_town(Town *town)
 // teleports the camera to the player position
 void Campaign::reset_camera()
 {
-	camera.position = meeple_controller.player->transform.position + glm::vec3(0.f, 10.f, -10.f);
-	camera.target(meeple_controller.player->transform.position);
+	camera.position = meeple_controller.player()->transform.position + glm::vec3(0.f, 10.f, -10.f);
+	camera.target(meeple_controller.player()->transform.position);
 }
 	
 // changes the target entity of a meeple
@@ -850,16 +993,16 @@ void Campaign::set_meeple_target(Meeple *meeple, uint32_t target_id, uint8_t tar
 
 	CampaignEntityType entity_type = CampaignEntityType(target_type);
 	if (entity_type == CampaignEntityType::TOWN) {
-		auto search = settlement_controller.towns.find(target_id);
-		if (search != settlement_controller.towns.end()) {
+		auto *search = settlement_controller.towns.find(target_id);
+		if (search) {
 			meeple->target_type = target_type;
 			meeple->target_id = target_id;
 		}
 	} else if (entity_type == CampaignEntityType::LAND_SURFACE) {
 		meeple->target_type = target_type;
 	} else if (entity_type == CampaignEntityType::MEEPLE) {
-		auto search = meeple_controller.meeples.find(target_id);
-		if (search != meeple_controller.meeples.end()) {
+		auto *search = meeple_controller.meeples.find(target_id);
+		if (search) {
 			meeple->target_type = target_type;
 			meeple->target_id = target_id;
 		}
@@ -876,9 +1019,8 @@ BoardMarker Campaign::marker_data(const glm::vec2 &position, uint32_t target_id,
 	if (type == CampaignEntityType::LAND_SURFACE) {
 		data.color = glm::vec3(0.8f, 0.8f, 1.f);
 	} else if (type == CampaignEntityType::TOWN) {
-		auto search = settlement_controller.towns.find(target_id);
-		if (search != settlement_controller.towns.end()) {
-			auto &town = search->second;
+		auto *town = settlement_controller.towns.find(target_id);
+		if (town) {
 			data.position = town->map_position();
 			data.radius = 2.5f;
 			if (town->faction == player_data.faction_id) {
@@ -888,9 +1030,8 @@ BoardMarker Campaign::marker_data(const glm::vec2 &position, uint32_t target_id,
 			}
 		}
 	} else if (type == CampaignEntityType::MEEPLE) {
-		auto search = meeple_controller.meeples.find(target_id);
-		if (search != meeple_controller.meeples.end()) {
-			auto &meeple = search->second;
+		auto *meeple = meeple_controller.meeples.find(target_id);
+		if (meeple) {
 			data.position = meeple->map_position();
 			data.radius = 1.f;
 			if (!meeple->faction_id) {
@@ -917,9 +1058,8 @@ void Campaign::update_meeple_target(Meeple *meeple)
 
 	CampaignEntityType entity_type = CampaignEntityType(meeple->target_type);
 	if (entity_type == CampaignEntityType::TOWN) {
-		auto search = settlement_controller.towns.find(meeple->target_id);
-		if (search != settlement_controller.towns.end()) {
-			const auto &town = search->second;
+		auto *town = settlement_controller.towns.find(meeple->target_id);
+		if (town) {
 			float distance = glm::distance(meeple->map_position(), town->map_position());
 			if (distance < 1.F) {
 				reached_target = true;
@@ -931,7 +1071,7 @@ void Campaign::update_meeple_target(Meeple *meeple)
 					town_prompt.choice = TownPromptChoice::UNDECIDED;
 				} else {
 					auto &fiefdom = settlement_controller.fiefdoms[town->fiefdom];
-					raze_town(town.get());
+					raze_town(town);
 					wipe_fiefdom(fiefdom.get());
 					meeple->clear_target();
 				}
@@ -942,15 +1082,15 @@ void Campaign::update_meeple_target(Meeple *meeple)
 			meeple->clear_target();
 		}
 	} else if (entity_type == CampaignEntityType::MEEPLE) {
-		auto search = meeple_controller.meeples.find(meeple->target_id);
-		if (search != meeple_controller.meeples.end()) {
+		auto *search = meeple_controller.meeples.find(meeple->target_id);
+		if (search) {
 			// if target is stationed ignore it
-			if (search->second->behavior_state == MeepleBehavior::STATIONED) {
+			if (search->behavior_state == MeepleBehavior::STATIONED) {
 				meeple->clear_target();
 				meeple->behavior_state = MeepleBehavior::PATROL;
 				return;
 			}
-			float distance = glm::distance(meeple->map_position(), search->second->map_position());
+			float distance = glm::distance(meeple->map_position(), search->map_position());
 			if (distance < 1.F) {
 				reached_target = true;
 				meeple->clear_target();
@@ -984,14 +1124,15 @@ void Campaign::update_marker(uint32_t target_id, uint8_t target_type)
 	// only need to update if dynamic entity
 	CampaignEntityType entity_type = CampaignEntityType(target_type);
 	if (entity_type == CampaignEntityType::MEEPLE) {
-		auto search = meeple_controller.meeples.find(target_id);
-		if (search != meeple_controller.meeples.end()) {
-			marker.position = search->second->map_position();
+		auto *search = meeple_controller.meeples.find(target_id);
+		if (search) {
+			marker.position = search->map_position();
 			board->set_marker(marker);
 		}
 	}
 }
 	
+#ifndef CAMPAIGN_HEADLESS
 void Campaign::update_debug_menu()
 {
 	ImGui::Begin("Cheat Menu");
@@ -1130,25 +1271,35 @@ void Campaign::set_player_movement(const glm::vec3 &ray)
 {
 	auto result = physics.cast_ray(camera.position, camera.position + (1000.f * ray), COLLISION_GROUP_HEIGHTMAP | COLLISION_GROUP_INTERACTION);
 	if (result.hit && result.object) {
-		if (result.object->getUserIndex() != player_data.meeple_id) {
+		// the handle is only unique within an entity type
+		const bool is_player = result.object->getUserIndex2() == int(CampaignEntityType::MEEPLE) && result.object->getUserIndex() == player_data.meeple_id;
+		if (!is_player) {
 			// if player is stationed in town unstation
-			if (meeple_controller.player->behavior_state == MeepleBehavior::STATIONED) {
-				unstation_meeple(meeple_controller.player);
+			if (meeple_controller.player()->behavior_state == MeepleBehavior::STATIONED) {
+				unstation_meeple(meeple_controller.player());
 			}
-			set_meeple_target(meeple_controller.player, result.object->getUserIndex(), result.object->getUserIndex2());
+			set_meeple_target(meeple_controller.player(), result.object->getUserIndex(), result.object->getUserIndex2());
 			// find initial path
 			glm::vec2 hitpoint = glm::vec2(result.point.x, result.point.z);
 			marker = marker_data(hitpoint, result.object->getUserIndex(), result.object->getUserIndex2());
+			// the player path is found right away, an older chase path should not replace it
+			m_paths.cancel(player_data.meeple_id);
 			std::list<glm::vec2> nodes;
-			board->find_path(meeple_controller.player->map_position(), marker.position, nodes);
+			RouteLeg leg = board->find_path(meeple_controller.player()->map_position(), marker.position, nodes);
 			// update visual marker
 			// marker color is based on entity type
 			if (nodes.size()) {
-				marker.position = nodes.back();
+				// the rest of a long route is found while walking
+				if (leg == RouteLeg::PARTIAL) {
+					meeple_controller.player()->route_end = marker.position;
+				} else {
+					marker.position = nodes.back();
+				}
 				board->set_marker(marker);
-				meeple_controller.player->set_path(nodes);
+				meeple_controller.player()->set_path(nodes);
+				meeple_controller.player()->long_route = leg == RouteLeg::PARTIAL;
 			
-				meeple_controller.player->behavior_state == MeepleBehavior::ATTACK;
+				meeple_controller.player()->behavior_state == MeepleBehavior::ATTACK;
 
 				// found a path so unpause
 				// if in pause mode unpause game
@@ -1162,8 +1313,9 @@ void Campaign::set_player_movement(const glm::vec3 &ray)
 	
 void Campaign::set_player_construction(const glm::vec3 &ray)
 {
-	auto result = physics.cast_ray(camera.position, camera.position + (1000.f * ray), COLLISION_GROUP_HEIGHTMAP);
-	const Tile *tile = board->atlas().tile_at(glm::vec2(result.point.x, result.point.z));
+	glm::vec3 point = {};
+	board->height_pyramid().intersect_ray(camera.position, camera.position + (1000.f * ray), point);
+	const Tile *tile = board->atlas().tile_at(glm::vec2(point.x, point.z));
 	const int town_cost = 100;
 
 	if (tile) {
@@ -1175,7 +1327,7 @@ void Campaign::set_player_construction(const glm::vec3 &ray)
 			if (faction_controller.factions[player_data.faction_id]->gold() >= town_cost) {
 				uint32_t id = spawn_town(tile, faction_controller.factions[player_data.faction_id].get());
 				if (id) {
-					Town *town = settlement_controller.towns[id].get();
+					Town *town = settlement_controller.towns.find(id);
 					place_town(town);
 					spawn_fiefdom(town);
 					// change mode
@@ -1187,6 +1339,7 @@ void Campaign::set_player_construction(const glm::vec3 &ray)
 		}
 	}
 }
+#endif
 
 void Campaign::transfer_town(Town *town, uint32_t faction)
 {
@@ -1257,7 +1410,7 @@ void Campaign::update_town_tick(Town *town, uint64_t ticks)
 // only used in cheat mode
 void Campaign::visit_current_tile()
 {
-	const auto &tile = board->tile_at(meeple_controller.player->map_position());
+	const auto &tile = board->tile_at(meeple_controller.player()->map_position());
 
 	if (tile) {
 		battle_data.tile = tile->index;
@@ -1274,9 +1427,8 @@ void Campaign::update_faction_taxes()
 		auto &faction = mapping.second;
 		int profit = 0;
 		for (const auto &town_id : faction->towns) {
-			auto search = settlement_controller.towns.find(town_id);
-			if (search != settlement_controller.towns.end()) {
-				const auto &town = search->second;
+			auto *town = settlement_controller.towns.find(town_id);
+			if (town) {
 				profit += 8 * town->size;
 			}
 		}
@@ -1289,11 +1441,13 @@ void Campaign::update_factions()
 {
 	// update faction gold after an elapsed game time period
 	// in game this means every month
-	if (game_ticks % 60 == 0) {
-		if (game_ticks > faction_ticks) {
+	// several ticks can pass at once so taxes are paid for every month that was crossed
+	if (game_ticks > faction_ticks) {
+		const uint64_t months = game_ticks / TICKS_PER_MONTH - faction_ticks / TICKS_PER_MONTH;
+		for (uint64_t i = 0; i < months; i++) {
 			update_faction_taxes();
-			faction_ticks = game_ticks;
 		}
+		faction_ticks = game_ticks / TICKS_PER_MONTH * TICKS_PER_MONTH;
 	}
 
 	// factions will look for new tiles to settle
@@ -1315,16 +1469,16 @@ void Campaign::update_factions()
 	auto faction_id = faction_controller.top_request();
 	if (faction_id) {
 		Faction *faction = faction_controller.factions[faction_id].get();
-		auto town_search = settlement_controller.towns.find(faction->capital_id);
-		if (town_search != settlement_controller.towns.end()) {
-			uint32_t capital_tile = town_search->second->tile;
+		auto *capital = settlement_controller.towns.find(faction->capital_id);
+		if (capital) {
+			uint32_t capital_tile = capital->tile;
 			if (faction->gold() >= 100) {
 				const auto &atlas = board->atlas();	
 				uint32_t tile = faction_controller.find_closest_town_target(atlas, faction, capital_tile);
 				if (tile) {
 					uint32_t id = spawn_town(&atlas.tiles()[tile], faction);
 					if (id) {
-						Town *town = settlement_controller.towns[id].get();
+						Town *town = settlement_controller.towns.find(id);
 						place_town(town);
 						spawn_fiefdom(town);
 						// town costs money
@@ -1398,12 +1552,18 @@ void Campaign::spawn_barbarians()
 	PoissonGenerator::DefaultPRNG PRNG(distrib(gen));
 	const auto positions = PoissonGenerator::generatePoissonPoints(32, PRNG, false);
 
+	std::vector<glm::vec2> candidates;
+	for (const auto &position : positions) {
+		candidates.push_back({ board->scale.x * position.x, board->scale.z * position.y });
+	}
+
+	std::vector<const Tile*> candidate_tiles;
+	atlas.tiles_at(candidates, candidate_tiles);
+
 	std::vector<glm::vec2> points;
 
-	for (const auto &position : positions) {
-		glm::vec2 point = { board->scale.x * position.x, board->scale.z * position.y };
-		const Tile *tile = board->atlas().tile_at(point);
-		if (walkable_tile(tile) && !faction_controller.tile_owners[tile->index]) {
+	for (const auto &tile : candidate_tiles) {
+		if (tile && walkable_tile(tile) && !faction_controller.tile_owners[tile->index]) {
 			glm::vec2 center = board->tile_center(tile->index);
 			points.push_back(center);
 		}
@@ -1413,21 +1573,19 @@ void Campaign::spawn_barbarians()
 	std::shuffle(points.begin(), points.end(), gen);
 
 	for (const auto &point : points) {
-		auto id = id_generator.generate();
-		auto meeple = std::make_unique<Meeple>();
+		auto id = meeple_controller.meeples.emplace();
+		Meeple *meeple = meeple_controller.meeples.find(id);
 		meeple->id = id;
 		meeple->control_type = MeepleControlType::AI_BARBARIAN;
 		meeple->teleport(point);
 		meeple->troop_count = troop_size_distrib(gen);
-		meeple_controller.meeples[id] = std::move(meeple);
 	}
 }
 	
 void Campaign::update_meeple_paths()
 {
-	for (auto &mapping : meeple_controller.meeples) {
-		auto &meeple = mapping.second;
-		update_meeple_path(meeple.get());
+	for (auto &meeple : meeple_controller.meeples) {
+		update_meeple_path(&meeple);
 	}
 }
 
@@ -1436,22 +1594,20 @@ void Campaign::update_meeple_path(Meeple *meeple)
 	CampaignEntityType entity_type = CampaignEntityType(meeple->target_type);
 	// dynamic target so update path
 	if (entity_type == CampaignEntityType::MEEPLE) {
-		auto search = meeple_controller.meeples.find(meeple->target_id);
-		if (search != meeple_controller.meeples.end()) {
-			const auto &target = search->second;
+		auto *target = meeple_controller.meeples.find(meeple->target_id);
+		if (target) {
 			// if target is stationed ignore it
 			if (target->behavior_state == MeepleBehavior::STATIONED) {
 				meeple->clear_target();
 				meeple->behavior_state = MeepleBehavior::PATROL;
 				return;
 			}
-			set_path_to_entity(meeple, target.get());
+			set_path_to_entity(meeple, target);
 		}
 	} else if (entity_type == CampaignEntityType::TOWN) {
-		auto search = settlement_controller.towns.find(meeple->target_id);
-		if (search != settlement_controller.towns.end()) {
-			const auto &target = search->second;
-			set_path_to_entity(meeple, target.get());
+		auto *target = settlement_controller.towns.find(meeple->target_id);
+		if (target) {
+			set_path_to_entity(meeple, target);
 		}
 	}
 }
@@ -1459,15 +1615,25 @@ void Campaign::update_meeple_path(Meeple *meeple)
 // finds the path to an entity
 void Campaign::set_path_to_entity(Meeple *meeple, const CampaignEntity *entity)
 {
-	std::list<glm::vec2> nodes;
 	glm::vec2 end_location = entity->map_position();
 	if (meeple->behavior_state == MeepleBehavior::EVADE) {
 		end_location = meeple->map_position() + (meeple->map_position() - entity->map_position());
 	}
-	board->find_path(meeple->map_position(), end_location, nodes);
-	if (nodes.size()) {
-		meeple->set_path(nodes);
+	request_path(meeple, end_location);
+}
+
+// long routes are found a leg at a time, the next leg is requested once the meeple has walked the current one
+void Campaign::request_path(Meeple *meeple, const glm::vec2 &end)
+{
+	glm::vec2 waypoint = end;
+	RouteLeg leg = board->route_leg(meeple->map_position(), end, waypoint);
+	meeple->long_route = leg == RouteLeg::PARTIAL;
+	meeple->route_end = end;
+	if (leg == RouteLeg::UNREACHABLE) {
+		return;
 	}
+
+	m_paths.request(meeple->id, meeple->map_position(), waypoint);
 }
 	
 void Campaign::update_meeple_behavior(Meeple *meeple)
@@ -1487,7 +1653,7 @@ void Campaign::update_meeple_behavior(Meeple *meeple)
 			btCollisionObject *obj = visibility->getOverlappingObject(i);
 			CampaignEntityType entity_type = CampaignEntityType(obj->getUserIndex2());
 			if (entity_type == CampaignEntityType::MEEPLE) {
-				Meeple *target = static_cast<Meeple*>(obj->getUserPointer());
+				Meeple *target = meeple_controller.meeples.find(obj->getUserIndex());
 				if (target) {
 					if (target->faction_id != meeple->faction_id) {
 						if (target->troop_count <= weakest_target_troops) {
@@ -1502,7 +1668,7 @@ void Campaign::update_meeple_behavior(Meeple *meeple)
 					}
 				}
 			} else if (entity_type == CampaignEntityType::TOWN) {
-				Town *target = static_cast<Town*>(obj->getUserPointer());
+				Town *target = settlement_controller.towns.find(obj->getUserIndex());
 				if (target) {
 					if (target->faction != meeple->faction_id) {
 						if (target->troop_count <= weakest_target_troops) {
@@ -1528,11 +1694,7 @@ void Campaign::update_meeple_behavior(Meeple *meeple)
 				meeple->behavior_state = MeepleBehavior::ATTACK;
 				set_meeple_target(meeple, weakest_target, uint8_t(weakest_target_type));
 				// find initial path
-				std::list<glm::vec2> nodes;
-				board->find_path(meeple->map_position(), map_position, nodes);
-				if (nodes.size()) {
-					meeple->set_path(nodes);
-				}
+				request_path(meeple, map_position);
 			}
 		} else {
 			// didn't find any targets
@@ -1546,17 +1708,16 @@ void Campaign::update_meeple_behavior(Meeple *meeple)
 
 void Campaign::check_meeple_visibility()
 {
-	for (auto &mapping : meeple_controller.meeples) {
-		auto &meeple = mapping.second;
-		meeple->visible = false;
+	for (auto &meeple : meeple_controller.meeples) {
+		meeple.visible = false;
 	}
-	const auto &visibility = meeple_controller.player->visibility()->ghost_object();
+	const auto &visibility = meeple_controller.player()->visibility()->ghost_object();
 	int count = visibility->getNumOverlappingObjects();
 	for (int i = 0; i < count; i++) {
 		btCollisionObject *obj = visibility->getOverlappingObject(i);
 		CampaignEntityType entity_type = CampaignEntityType(obj->getUserIndex2());
 		if (entity_type == CampaignEntityType::MEEPLE) {
-			Meeple *target = static_cast<Meeple*>(obj->getUserPointer());
+			Meeple *target = meeple_controller.meeples.find(obj->getUserIndex());
 			if (target) {
 				target->visible = true;
 			}
@@ -1564,8 +1725,8 @@ void Campaign::check_meeple_visibility()
 	}
 
 	// make player always visible unless stationed
-	if (meeple_controller.player->behavior_state != MeepleBehavior::STATIONED) {
-		meeple_controller.player->visible = true;
+	if (meeple_controller.player()->behavior_state != MeepleBehavior::STATIONED) {
+		meeple_controller.player()->visible = true;
 	}
 }
 	
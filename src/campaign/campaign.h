@@ -1,6 +1,9 @@
 #pragma once
+#include <future>
+#include <random>
 #include "../extern/namegen/namegen.h"
 #include "atlas.h"
+#include "routeplanner.h"
 #include "board.h"
 #include "entity.h"
 #include "meeple.h"
@@ -8,6 +11,8 @@
 #include "faction.h"
 #include "prompt.h"
 
+static const uint64_t TICKS_PER_MONTH = 60; // factions collect taxes every month
+
 enum class CampaignState {
 	RUNNING,
 	PAUSED,
@@ -75,6 +80,7 @@ struct CampaignGenParams {
 	float map_size = 0.f;
 	int faction_count = 0;
 	AtlasParameters atlas = {};
+	std::string cache_directory = {}; // where generated worlds are cached, empty to disable
 };
 
 // the overworld
@@ -94,7 +100,9 @@ public:
 	util::IdGenerator id_generator;
 	fysx::PhysicalSystem physics;
 	std::unique_ptr<Board> board;
+#ifndef CAMPAIGN_HEADLESS
 	FontManager font_manager;
+#endif
 	MeepleController meeple_controller;
 	SettlementController settlement_controller;
 	FactionController faction_controller;
@@ -109,6 +117,7 @@ public: // to keep track of game time
 	float hourglass_sand = 0.f;
 	uint64_t game_ticks = 0; // for every n seconds a new game tick is added
 	uint64_t faction_ticks = 0;
+#ifndef CAMPAIGN_HEADLESS
 public:
 	std::shared_ptr<gfx::Shader> object_shader;
 	std::shared_ptr<gfx::Shader> meeple_shader;
@@ -118,23 +127,48 @@ public:
 	bool display_debug = false;
 	bool wireframe_worldmap = false;
 	std::unique_ptr<Debugger> debugger;
+#endif
 public:
 	void load(const std::string &filepath);
 	void save(const std::string &filepath);
 	void generate(const CampaignGenParams& gen_params);
+	// generates the board on a worker thread, the caller polls until it is ready and then finishes it on the main thread
+	void start_generation(const CampaignGenParams& gen_params);
+	bool generation_ready() const;
+	bool finish_generation(); // false if the generation was cancelled
+	void cancel_generation();
+	const util::Progress& generation_progress() const { return m_generation_progress; }
 	void prepare();
 	void clear();
 public:
+	~Campaign();
+#ifndef CAMPAIGN_HEADLESS
 	void init(const gfx::ShaderGroup *shaders);
 	void load_blueprints(const Module &module);
 	void update(float delta);
 	void display();
+#endif
+	void init_headless(); // without rendering, the campaign can only be simulated
+	void simulate(uint64_t ticks);
 	void reset_camera();
+private:
+	CampaignGenParams m_gen_params = {};
+	util::Progress m_generation_progress; // declared before the generation so it outlives the worker
+	std::future<bool> m_generation;
+	std::mt19937 m_random; // seeded from the campaign so simulations can be repeated
+	util::PathService m_paths; // AI paths are found on worker threads
+private:
+	void advance_ticks(uint64_t ticks);
+	void step_world(float delta);
+	void deliver_paths(size_t budget);
+#ifndef CAMPAIGN_HEADLESS
 private:
 	void display_labels();
 private:
 	void update_debug_menu();
 	void update_camera(float delta);
+#endif
+private:
 	void visit_current_tile();
 private:
 	uint32_t spawn_town(const Tile *tile, Faction *faction);
@@ -145,9 +179,11 @@ private:
 private:
 	void spawn_fiefdom(Town *town);
 	void wipe_fiefdom(Fiefdom *fiefdom);
+#ifndef CAMPAIGN_HEADLESS
 private:
 	void set_player_movement(const glm::vec3 &ray);
 	void set_player_construction(const glm::vec3 &ray);
+#endif
 private:
 	void place_meeple(Meeple *meeple);
 	void station_meeple(Meeple *meeple, Town *town);
@@ -156,6 +192,7 @@ private:
 	void update_meeple_target(Meeple *meeple);
 	void spawn_barbarians();
 	void update_meeple_path(Meeple *meeple);
+	void request_path(Meeple *meeple, const glm::vec2 &end);
 	void set_path_to_entity(Meeple *meeple, const CampaignEntity *entity);
 	void update_meeple_paths();
 	void update_meeple_behavior(Meeple *meeple);
@@ -1,3 +1,4 @@
+namespace gfx { class Model; }; // only pointed to so the simulation builds without the renderer
 
 class CampaignEntity {
 public:
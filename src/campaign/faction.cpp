@@ -9,6 +9,7 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include "../util/serialize.h"
 #include "../geometry/geometry.h"
 #include "../geometry/voronoi.h"
 #include "../geometry/transform.h"
@@ -62,7 +63,7 @@ void FactionController::clear()
 }
 
 // uses breadth first search to select a radius of tiles around a selected tile to reserve them
-void FactionController::target_town_tiles(const Tile &tile, const Atlas &atlas, int radius, std::unordered_map<uint32_t, bool> &visited, std::unordered_map<uint32_t, uint32_t> &depth)
+void FactionController::target_town_tiles(const Tile &tile, const Atlas &atlas, int radius, std::vector<bool> &visited, std::vector<uint32_t> &depth)
 {
 	const auto &cells = atlas.graph().cells;	
 	const auto &borders = atlas.borders();	
@@ -105,8 +106,10 @@ void FactionController::find_town_targets(const Atlas &atlas, int radius)
 
 	// do breath first search
 	//
-	std::unordered_map<uint32_t, bool> visited;
-	std::unordered_map<uint32_t, uint32_t> depth;
+	std::vector<bool> visited(tiles.size(), false);
+	std::vector<uint32_t> depth(tiles.size(), 0);
+
+	m_desirable_tiles.assign(tiles.size(), false);
 
 	// to shuffle 
 	std::random_device rd;
@@ -114,7 +117,6 @@ void FactionController::find_town_targets(const Atlas &atlas, int radius)
 
 	// first do tiles near river and coast
 	for (const auto &tile : tiles) {
-		m_desirable_tiles[tile.index] = false;
 		bool ideal_start = (tile.flags & TILE_FLAG_RIVER) && (tile.flags & TILE_FLAG_COAST);
 		if (!visited[tile.index] && walkable_tile(&tile) && ideal_start) {
 			// found target
@@ -163,11 +165,11 @@ void FactionController::find_town_targets(const Atlas &atlas, int radius)
 // if it doesn't find a tile it will return 0
 uint32_t FactionController::find_closest_town_target(const Atlas &atlas, Faction *faction, uint32_t origin_tile)
 {
-	const auto &cells = atlas.graph().cells;	
+	const auto &topology = atlas.graph().topology();	
 	const auto &tiles = atlas.tiles();	
 	const auto &borders = atlas.borders();	
 
-	std::unordered_map<uint32_t, bool> visited;
+	std::vector<bool> visited(tiles.size(), false);
 	visited[origin_tile] = true;
 
 	std::queue<uint32_t> nodes;
@@ -176,13 +178,11 @@ uint32_t FactionController::find_closest_town_target(const Atlas &atlas, Faction
 	while (!nodes.empty()) {
 		auto node = nodes.front();
 		nodes.pop();
-		//for (const auto &cell : cells[node].neighbors) {
-		const auto &cell = cells[node];
-		for (const auto &edge : cell.edges) {
-			const auto &border = borders[edge->index];
+		for (uint32_t edge : topology.cell_edges[node]) {
+			const auto &border = borders[edge];
 			// if no river is between them
 			if (!(border.flags & BORDER_FLAG_RIVER) && !(border.flags & BORDER_FLAG_FRONTIER)) {
-				auto neighbor_index = edge->left_cell->index == node ? edge->right_cell->index : edge->left_cell->index;
+				auto neighbor_index = topology.opposite_cell(edge, node);
 				const Tile *neighbor = &tiles[neighbor_index];
 				// is it a land tile and has it not been visited yet?
 				if (walkable_tile(neighbor) && !visited[neighbor->index]) {
@@ -30,14 +30,28 @@ private:
 
 class FactionController {
 public:
-	std::unordered_map<uint32_t, uint32_t> tile_owners; // left: tile ID, right: faction ID, 0 means tile is not occupied by a faction
+	std::vector<uint32_t> tile_owners; // faction ID of every tile, 0 means tile is not occupied by a faction
 	std::unordered_map<uint32_t, std::unique_ptr<Faction>> factions;
 	std::vector<uint32_t> town_targets; // tiles where faction AI will try to place towns on
 public:
 	template <class Archive>
-	void serialize(Archive &archive)
+	void save(Archive &archive) const
+	{
+		archive(factions);
+		util::save_runs(archive, tile_owners);
+		archive(town_targets);
+		util::save_runs(archive, m_desirable_tiles);
+	}
+	template <class Archive>
+	void load(Archive &archive)
 	{
-		archive(factions,  tile_owners, town_targets, m_desirable_tiles);
+		archive(factions);
+		util::load_runs(archive, tile_owners);
+		archive(town_targets);
+		util::load_runs(archive, m_desirable_tiles);
+		if (m_desirable_tiles.size() != tile_owners.size()) {
+			throw cereal::Exception("faction tile arrays differ in size");
+		}
 	}
 public:
 	void clear();
@@ -46,9 +60,9 @@ public:
 	void add_expand_request(uint32_t faction_id);
 	uint32_t top_request();
 private:
-	std::unordered_map<uint32_t, bool> m_desirable_tiles;
+	std::vector<bool> m_desirable_tiles; // for every tile
 	std::queue<uint32_t> m_expansion_requests; // queue with ids of factions that request expansion
 	uint64_t m_internal_ticks = 0;
 private:
-	void target_town_tiles(const Tile &tile, const Atlas &atlas, int radius, std::unordered_map<uint32_t, bool> &visited, std::unordered_map<uint32_t, uint32_t> &depth);
+	void target_town_tiles(const Tile &tile, const Atlas &atlas, int radius, std::vector<bool> &visited, std::vector<uint32_t> &depth);
 };
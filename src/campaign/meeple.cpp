@@ -4,8 +4,10 @@
 #include <string>
 #include <unordered_map>
 
+#ifndef CAMPAIGN_HEADLESS
 #include <GL/glew.h>
 #include <GL/gl.h>
+#endif
 
 #include <glm/glm.hpp>
 #include <glm/vec3.hpp>
@@ -16,10 +18,13 @@
 #include "../geometry/geometry.h"
 #include "../geometry/transform.h"
 #include "../util/animation.h"
+#include "../util/slotmap.h"
 #include "../physics/physical.h"
 #include "../physics/trigger.h"
+#ifndef CAMPAIGN_HEADLESS
 #include "../graphics/mesh.h"
 #include "../graphics/model.h"
+#endif
 
 #include "entity.h"
 #include "meeple.h"
@@ -98,12 +103,7 @@ Meeple::Meeple()
 	sphere.radius = MEEPLE_VISIBILITY_RADIUS;
 	m_visibility = std::make_unique<fysx::TriggerSphere>(sphere);
 
-	m_visibility->ghost_object()->setUserPointer(this);
-	m_trigger->ghost_object()->setUserPointer(this);
-
 	transform.scale = glm::vec3(0.01f);
-	
-	m_joint_matrices.buffer.set_target(GL_SHADER_STORAGE_BUFFER);
 }
 
 const fysx::TriggerSphere* Meeple::trigger() const { return m_trigger.get(); }
@@ -156,6 +156,7 @@ void Meeple::update(float delta)
 	}
 }
 	
+#ifndef CAMPAIGN_HEADLESS
 void Meeple::update_animation(float delta)
 {
 	if (m_path_finder.state() != PathState::FINISHED) {
@@ -170,13 +171,14 @@ void Meeple::update_animation(float delta)
 	for (const auto &skin : model->skins()) {
 		if (skin->inverse_binds.size() == m_animation_controller->models.size()) {
 			for (int i = 0; i < m_animation_controller->models.size(); i++) {
-				m_joint_matrices.data[i] = util::ozz_to_mat4(m_animation_controller->models[i]) * skin->inverse_binds[i];
+				m_joint_matrices->data[i] = util::ozz_to_mat4(m_animation_controller->models[i]) * skin->inverse_binds[i];
 			}
 			break; // only animate first skin
 		}
 	}
-	m_joint_matrices.update_present();
+	m_joint_matrices->update_present();
 }
+#endif
 
 void Meeple::teleport(const glm::vec2 &position)
 {
@@ -189,6 +191,7 @@ void Meeple::teleport(const glm::vec2 &position)
 void Meeple::clear_path()
 {
 	m_path_finder.clear_path();
+	long_route = false;
 }
 	
 void Meeple::clear_target()
@@ -204,40 +207,43 @@ void Meeple::sync()
 	m_path_finder.teleport(glm::vec2(transform.position.x, transform.position.z));
 }
 
+#ifndef CAMPAIGN_HEADLESS
 void Meeple::set_animation(const util::AnimationSet *set)
 {
 	m_animation_controller = std::make_unique<util::AnimationController>(set);
-	m_joint_matrices.data.resize(set->skeleton->num_joints());
-	m_joint_matrices.update_present();
+	m_joint_matrices = std::make_unique<gfx::BufferDataPair<glm::mat4>>();
+	m_joint_matrices->buffer.set_target(GL_SHADER_STORAGE_BUFFER);
+	m_joint_matrices->data.resize(set->skeleton->num_joints());
+	m_joint_matrices->update_present();
 }
 	
 void Meeple::display() const
 {
-	m_joint_matrices.buffer.bind_base(0);
+	m_joint_matrices->buffer.bind_base(0);
 		
 	model->display();
 }
+#endif
 	
 void MeepleController::update(float delta)
 {
-	for (auto &mapping : meeples) {
-		auto &meeple = mapping.second;
-		meeple->update(delta);
-		//meeple->update_animation(delta);
+	for (auto &meeple : meeples) {
+		meeple.update(delta);
+		//meeple.update_animation(delta);
 	}
 }
 	
 void MeepleController::add_ticks(uint64_t ticks)
 {
-	for (auto &mapping : meeples) {
-		auto &meeple = mapping.second;
-		meeple->ticks += ticks;
+	for (auto &meeple : meeples) {
+		meeple.ticks += ticks;
 	}
 }
 	
 void MeepleController::clear()
 {
 	meeples.clear();
+	player_id = 0;
 }
 	
 /*
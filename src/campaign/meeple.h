@@ -60,16 +60,24 @@ public:
 public:
 	bool moving = false;
 	uint32_t troop_count = 1; // including the leader
+	bool long_route = false; // the path only reaches the next waypoint of the route
+	glm::vec2 route_end = {};
 public:
 	Meeple();
+#ifndef CAMPAIGN_HEADLESS
 	void set_animation(const util::AnimationSet *set);
+#endif
 public:
 	void update(float delta);
+#ifndef CAMPAIGN_HEADLESS
 	void update_animation(float delta);
+#endif
 	void teleport(const glm::vec2 &position);
 	void sync();
+#ifndef CAMPAIGN_HEADLESS
 public:
 	void display() const;
+#endif
 public:
 	void set_speed(float speed);
 	void set_path(const std::list<glm::vec2> &nodes);
@@ -95,7 +103,9 @@ private:
 private:
 	MeepleAnimation m_animation = MA_IDLE;
 	std::unique_ptr<util::AnimationController> m_animation_controller;
-	gfx::BufferDataPair<glm::mat4> m_joint_matrices;
+#ifndef CAMPAIGN_HEADLESS
+	std::unique_ptr<gfx::BufferDataPair<glm::mat4>> m_joint_matrices; // created with the animation so headless meeples need no GL
+#endif
 private:
 	std::unique_ptr<fysx::TriggerSphere> m_trigger;
 	std::unique_ptr<fysx::TriggerSphere> m_visibility;
@@ -103,9 +113,10 @@ private:
 
 class MeepleController {
 public:
-	Meeple *player = nullptr;
-	std::unordered_map<uint32_t, std::unique_ptr<Meeple>> meeples;
+	uint32_t player_id = 0; // handle of the meeple controlled by the player
+	util::SlotMap<Meeple> meeples;
 public:
+	Meeple* player() { return meeples.find(player_id); }
 	void update(float delta);
 	void add_ticks(uint64_t ticks);
 	void clear();
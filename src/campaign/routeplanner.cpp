@@ -0,0 +1,267 @@
+#include <vector>
+#include <algorithm>
+#include <queue>
+#include <limits>
+#include <string>
+#include <unordered_map>
+#include <glm/glm.hpp>
+
+#include "../geometry/geometry.h"
+#include "../geometry/voronoi.h"
+#include "../util/image.h"
+
+#include "atlas.h"
+#include "routeplanner.h"
+
+static const uint32_t CLUSTER_TILES = 64; // most tiles in a cluster
+static const size_t REFINED_CLUSTERS = 3; // clusters of a route searched on the navmesh at once
+
+// land tiles that can be crossed to each other
+static bool passable_border(const Border &border)
+{
+	return !(border.flags & (BORDER_FLAG_RIVER | BORDER_FLAG_FRONTIER));
+}
+
+void RoutePlanner::build(const Atlas &atlas)
+{
+	clear();
+
+	grow_clusters(atlas);
+	link_clusters(atlas);
+	label_components();
+}
+
+void RoutePlanner::clear()
+{
+	m_tile_clusters.clear();
+	m_cluster_centers.clear();
+	m_cluster_components.clear();
+	m_link_offsets.clear();
+	m_links.clear();
+}
+
+// breadth first search from every tile that is not in a cluster yet, until the cluster is full
+// so clusters stay compact and every cluster is connected on its own
+void RoutePlanner::grow_clusters(const Atlas &atlas)
+{
+	const auto &tiles = atlas.tiles();
+	const auto &borders = atlas.borders();
+	const auto &topology = atlas.graph().topology();
+
+	m_tile_clusters.assign(tiles.size(), -1);
+
+	std::vector<uint32_t> queue;
+	queue.reserve(CLUSTER_TILES);
+
+	for (const auto &root : tiles) {
+		if (m_tile_clusters[root.index] >= 0 || !walkable_tile(&root)) {
+			continue;
+		}
+
+		const int32_t cluster = m_cluster_centers.size();
+		m_tile_clusters[root.index] = cluster;
+
+		queue.clear();
+		queue.push_back(root.index);
+		for (size_t front = 0; front < queue.size() && queue.size() < CLUSTER_TILES; front++) {
+			const uint32_t node = queue[front];
+			for (uint32_t edge : topology.cell_edges[node]) {
+				const uint32_t neighbor = topology.opposite_cell(edge, node);
+				if (neighbor == node || m_tile_clusters[neighbor] >= 0) {
+					continue;
+				}
+				if (passable_border(borders[edge]) && walkable_tile(&tiles[neighbor])) {
+					m_tile_clusters[neighbor] = cluster;
+					queue.push_back(neighbor);
+					if (queue.size() == CLUSTER_TILES) {
+						break;
+					}
+				}
+			}
+		}
+
+		// the middle might not be on land so take the tile closest to it
+		glm::vec2 middle = {};
+		for (uint32_t tile : queue) {
+			middle += topology.cell_centers[tile];
+		}
+		middle /= float(queue.size());
+
+		glm::vec2 center = topology.cell_centers[root.index];
+		for (uint32_t tile : queue) {
+			if (glm::distance(topology.cell_centers[tile], middle) < glm::distance(center, middle)) {
+				center = topology.cell_centers[tile];
+			}
+		}
+
+		m_cluster_centers.push_back(center);
+	}
+}
+
+// clusters are linked through the tile pair that makes the shortest detour between their centers
+void RoutePlanner::link_clusters(const Atlas &atlas)
+{
+	const auto &borders = atlas.borders();
+	const auto &topology = atlas.graph().topology();
+
+	std::vector<std::vector<Link>> links(m_cluster_centers.size());
+
+	for (uint32_t tile = 0; tile < m_tile_clusters.size(); tile++) {
+		const int32_t cluster = m_tile_clusters[tile];
+		if (cluster < 0) {
+			continue;
+		}
+		for (uint32_t edge : topology.cell_edges[tile]) {
+			const uint32_t neighbor = topology.opposite_cell(edge, tile);
+			const int32_t neighbor_cluster = m_tile_clusters[neighbor];
+			if (neighbor_cluster < 0 || neighbor_cluster == cluster || !passable_border(borders[edge])) {
+				continue;
+			}
+
+			const glm::vec2 &entry = topology.cell_centers[neighbor];
+			const float cost = glm::distance(m_cluster_centers[cluster], entry) + glm::distance(entry, m_cluster_centers[neighbor_cluster]);
+
+			auto &cluster_links = links[cluster];
+			auto search = std::find_if(cluster_links.begin(), cluster_links.end(), [neighbor_cluster](const Link &link) { return link.cluster == uint32_t(neighbor_cluster); });
+			if (search == cluster_links.end()) {
+				cluster_links.push_back({ uint32_t(neighbor_cluster), entry, cost });
+			} else if (cost < search->cost) {
+				search->entry = entry;
+				search->cost = cost;
+			}
+		}
+	}
+
+	// flatten
+	m_link_offsets.reserve(links.size() + 1);
+	for (const auto &cluster_links : links) {
+		m_link_offsets.push_back(m_links.size());
+		m_links.insert(m_links.end(), cluster_links.begin(), cluster_links.end());
+	}
+	m_link_offsets.push_back(m_links.size());
+}
+
+void RoutePlanner::label_components()
+{
+	const uint32_t unlabeled = std::numeric_limits<uint32_t>::max();
+
+	m_cluster_components.assign(m_cluster_centers.size(), unlabeled);
+
+	std::vector<uint32_t> queue;
+	uint32_t label = 0;
+	for (uint32_t root = 0; root < m_cluster_centers.size(); root++) {
+		if (m_cluster_components[root] != unlabeled) {
+			continue;
+		}
+		m_cluster_components[root] = label;
+		queue.clear();
+		queue.push_back(root);
+		for (size_t front = 0; front < queue.size(); front++) {
+			const uint32_t node = queue[front];
+			for (uint32_t i = m_link_offsets[node]; i < m_link_offsets[node+1]; i++) {
+				const uint32_t neighbor = m_links[i].cluster;
+				if (m_cluster_components[neighbor] == unlabeled) {
+					m_cluster_components[neighbor] = label;
+					queue.push_back(neighbor);
+				}
+			}
+		}
+		label++;
+	}
+}
+
+// A* on the cluster graph
+// only the visited clusters are stored so a short route stays cheap on a huge map
+bool RoutePlanner::find_route(uint32_t start, uint32_t end, std::vector<uint32_t> &route) const
+{
+	struct Visit {
+		float cost = 0.f;
+		uint32_t link = 0; // link the cluster was reached through
+	};
+	using Candidate = std::pair<float, uint32_t>;
+
+	std::unordered_map<uint32_t, Visit> visits;
+	std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate>> frontier;
+
+	const glm::vec2 &goal = m_cluster_centers[end];
+
+	visits[start] = { 0.f, 0 };
+	frontier.push({ glm::distance(m_cluster_centers[start], goal), start });
+
+	while (!frontier.empty()) {
+		const uint32_t node = frontier.top().second;
+		const float estimate = frontier.top().first;
+		frontier.pop();
+
+		const float cost = visits[node].cost;
+		if (node == end) {
+			break;
+		}
+		// already reached with a lower cost
+		if (estimate > cost + glm::distance(m_cluster_centers[node], goal)) {
+			continue;
+		}
+
+		for (uint32_t i = m_link_offsets[node]; i < m_link_offsets[node+1]; i++) {
+			const auto &link = m_links[i];
+			const float neighbor_cost = cost + link.cost;
+			auto search = visits.find(link.cluster);
+			if (search == visits.end() || neighbor_cost < search->second.cost) {
+				visits[link.cluster] = { neighbor_cost, i };
+				frontier.push({ neighbor_cost + glm::distance(m_cluster_centers[link.cluster], goal), link.cluster });
+			}
+		}
+	}
+
+	if (visits.find(end) == visits.end()) {
+		return false;
+	}
+
+	// walk back from the end, the cluster a link starts from is found from the offsets
+	route.clear();
+	uint32_t node = end;
+	while (node != start) {
+		const uint32_t link = visits[node].link;
+		route.push_back(link);
+		auto offset = std::upper_bound(m_link_offsets.begin(), m_link_offsets.end(), link);
+		node = std::distance(m_link_offsets.begin(), offset) - 1;
+	}
+	std::reverse(route.begin(), route.end());
+
+	return true;
+}
+
+RouteLeg RoutePlanner::next_leg(uint32_t start_tile, uint32_t end_tile, glm::vec2 &waypoint) const
+{
+	if (start_tile >= m_tile_clusters.size() || end_tile >= m_tile_clusters.size()) {
+		return RouteLeg::DIRECT;
+	}
+
+	const int32_t start = m_tile_clusters[start_tile];
+	const int32_t end = m_tile_clusters[end_tile];
+	// not on land, leave it to the navmesh to find the closest point
+	if (start < 0 || end < 0) {
+		return RouteLeg::DIRECT;
+	}
+
+	if (m_cluster_components[start] != m_cluster_components[end]) {
+		return RouteLeg::UNREACHABLE;
+	}
+
+	if (start == end) {
+		return RouteLeg::DIRECT;
+	}
+
+	std::vector<uint32_t> route;
+	if (!find_route(start, end, route)) {
+		return RouteLeg::UNREACHABLE;
+	}
+
+	if (route.size() <= REFINED_CLUSTERS) {
+		return RouteLeg::DIRECT;
+	}
+
+	waypoint = m_links[route[REFINED_CLUSTERS-1]].entry;
+
+	return RouteLeg::PARTIAL;
+}
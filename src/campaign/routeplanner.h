@@ -0,0 +1,36 @@
+enum class RouteLeg {
+	DIRECT, // the end is close enough to find the whole path at once
+	PARTIAL, // only the path to the waypoint is found now, the rest of the route follows once it is reached
+	UNREACHABLE // no route over land
+};
+
+// coarse route planning on clusters of walkable tiles
+// a detailed path over the whole map is slow and gets truncated, so the navmesh is only searched for the next few clusters of a route
+// tiles that are separated by a river or the map frontier are not connected
+class RoutePlanner {
+public:
+	// clusters are grown from the tile graph and their connectivity is found up front
+	void build(const Atlas &atlas);
+	void clear();
+	// finds the waypoint the detailed path from the start tile should reach next
+	RouteLeg next_leg(uint32_t start_tile, uint32_t end_tile, glm::vec2 &waypoint) const;
+public:
+	size_t cluster_count() const { return m_cluster_centers.size(); }
+private:
+	struct Link {
+		uint32_t cluster;
+		glm::vec2 entry; // center of the first tile of the linked cluster on the way there
+		float cost;
+	};
+	std::vector<int32_t> m_tile_clusters; // cluster of each tile, -1 if the tile is not walkable
+	std::vector<glm::vec2> m_cluster_centers; // center of the tile closest to the middle of the cluster
+	std::vector<uint32_t> m_cluster_components; // clusters in the same component are connected
+	std::vector<uint32_t> m_link_offsets; // links of cluster i are in [offsets[i], offsets[i+1])
+	std::vector<Link> m_links;
+private:
+	void grow_clusters(const Atlas &atlas);
+	void link_clusters(const Atlas &atlas);
+	void label_components();
+	// the links from the start cluster to the end cluster
+	bool find_route(uint32_t start, uint32_t end, std::vector<uint32_t> &route) const;
+};
@@ -4,18 +4,15 @@
 #include <memory>
 #include <unordered_map>
 
-#include <GL/glew.h>
-#include <GL/gl.h>
-
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include "../util/serialize.h"
+#include "../util/slotmap.h"
 #include "../geometry/geometry.h"
 #include "../geometry/transform.h"
 #include "../physics/physical.h"
 #include "../physics/trigger.h"
-#include "../graphics/mesh.h"
-#include "../graphics/model.h"
 
 #include "entity.h"
 #include "settlement.h"
@@ -28,7 +25,6 @@ Settlement::Settlement()
 	};
 
 	trigger = std::make_unique<fysx::TriggerSphere>(sphere);
-	trigger->ghost_object()->setUserPointer(this);
 }
 
 void Settlement::set_position(const glm::vec3 &position)
@@ -63,14 +63,21 @@ private:
 
 class SettlementController {
 public:
-	std::unordered_map<uint32_t, std::unique_ptr<Town>> towns;
+	util::SlotMap<Town> towns;
 	std::unordered_map<uint32_t, std::unique_ptr<Fiefdom>> fiefdoms;
-	std::unordered_map<uint32_t, uint32_t> tile_owners; // left: tile ID, right: fiefdom ID
+	std::vector<uint32_t> tile_owners; // fiefdom ID of every tile, 0 if none
 public:
 	template <class Archive>
-	void serialize(Archive &archive)
+	void save(Archive &archive) const
+	{
+		archive(towns, fiefdoms);
+		util::save_runs(archive, tile_owners);
+	}
+	template <class Archive>
+	void load(Archive &archive)
 	{
-		archive(towns, fiefdoms, tile_owners);
+		archive(towns, fiefdoms);
+		util::load_runs(archive, tile_owners);
 	}
 public:
 	void clear()
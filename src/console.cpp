@@ -3,10 +3,6 @@
 #include <vector>
 
 #include "extern/imgui/imgui.h"
-//#include <extern/imgui/backends/imgui_impl_opengl3.h>
-//#include <extern/imgui/backends/imgui_impl_sdl.h>
-#include "extern/imgui/imgui_impl_opengl3.h"
-#include "extern/imgui/imgui_impl_sdl.h"
 
 #include "console.h"
 
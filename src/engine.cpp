@@ -29,7 +29,7 @@ static const char *GAME_NAME = "terranova";
 // returns true if a user directory exists
 bool UserDirectory::locate(const char *base)
 {
-	return (locate_dir(base, "settings", settings) && locate_dir(base, "saves", saves));
+	return (locate_dir(base, "settings", settings) && locate_dir(base, "saves", saves) && locate_dir(base, "cache", cache));
 }
 
 // finds the user data directory 
@@ -103,7 +103,11 @@ Engine::Engine()
 	campaign_gen_params.seed = distrib(gen);
 	campaign_gen_params.map_size = 1024.f;
 	campaign_gen_params.faction_count = 24;
+	campaign_gen_params.cache_directory = user_dir.cache;
 	campaign_gen_params.atlas.tile_count = 8000;
+	campaign_gen_params.atlas.resolution = 2048;
+	campaign_gen_params.atlas.erosion_iterations = 64;
+	campaign_gen_params.atlas.erosion_resolution = 1024;
 	campaign_gen_params.atlas.lowland = 114;
 	campaign_gen_params.atlas.hills = 147;
 	campaign_gen_params.atlas.mountains = 168;
@@ -339,7 +343,8 @@ void Engine::run()
 	load_module();
 
 	// the main menu loop
-	while (state == EngineState::TITLE) {
+	// the menu keeps running while a new world is being generated
+	while (state == EngineState::TITLE || state == EngineState::GENERATING_CAMPAIGN) {
 		util::InputManager::update(); // user keyboard and mouse input
 
 		SDL_Event event = {};
@@ -349,10 +354,15 @@ void Engine::run()
 		}
 
 		if (util::InputManager::exit_request()) {
+			campaign.cancel_generation(); // don't wait for a world nobody will see
 			state = EngineState::EXIT;
 		}
 
-		update_main_menu();
+		if (state == EngineState::GENERATING_CAMPAIGN) {
+			update_generation_menu();
+		} else {
+			update_main_menu();
+		}
 
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
@@ -364,9 +374,17 @@ void Engine::run()
 		// start a new campaign
 		if (state == EngineState::NEW_CAMPAIGN) {
 			campaign.clear();
-			campaign.generate(campaign_gen_params);
-			campaign.reset_camera();
-			state = EngineState::RUNNING_CAMPAIGN;
+			campaign.start_generation(campaign_gen_params);
+			state = EngineState::GENERATING_CAMPAIGN;
+		}
+		// wait for the world to be generated
+		if (state == EngineState::GENERATING_CAMPAIGN && campaign.generation_ready()) {
+			if (campaign.finish_generation()) {
+				campaign.reset_camera();
+				state = EngineState::RUNNING_CAMPAIGN;
+			} else {
+				state = EngineState::TITLE; // cancelled
+			}
 		}
 		// load a campaign from save file
 		if (state == EngineState::LOADING_CAMPAIGN) {
@@ -485,6 +503,9 @@ void Engine::update_main_menu()
 		}
 		ImGui::InputInt("factions", &campaign_gen_params.faction_count);
 		ImGui::InputInt("tiles", &campaign_gen_params.atlas.tile_count);
+		ImGui::InputInt("resolution", &campaign_gen_params.atlas.resolution);
+		ImGui::InputInt("erosion iterations", &campaign_gen_params.atlas.erosion_iterations);
+		ImGui::InputInt("erosion resolution", &campaign_gen_params.atlas.erosion_resolution);
 		ImGui::InputInt("lowland", &campaign_gen_params.atlas.lowland);
 		ImGui::InputInt("hills", &campaign_gen_params.atlas.hills);
 		ImGui::InputInt("mountains", &campaign_gen_params.atlas.mountains);
@@ -507,3 +528,23 @@ void Engine::update_main_menu()
 	if (ImGui::Button("Exit")) { state = EngineState::EXIT; }
 	ImGui::End();
 }
+
+void Engine::update_generation_menu()
+{
+	const auto &progress = campaign.generation_progress();
+
+	ImGui_ImplOpenGL3_NewFrame();
+	ImGui_ImplSDL2_NewFrame(window);
+	ImGui::NewFrame();
+	ImGui::Begin("Generating World");
+	ImGui::Text("seed %d", campaign_gen_params.seed);
+	ImGui::ProgressBar(progress.fraction());
+	ImGui::Text("%u / %u stages, last finished: %s", progress.finished_stages(), progress.total_stages(), progress.last_stage().c_str());
+	ImGui::Separator();
+	if (progress.cancelled()) {
+		ImGui::Text("cancelling...");
+	} else if (ImGui::Button("Cancel")) {
+		campaign.cancel_generation();
+	}
+	ImGui::End();
+}
@@ -1,15 +1,18 @@
 #pragma once
 #include "util/serialize.h"
+#include "util/slotmap.h"
 #include "util/config.h"
 #include "util/input.h"
 #include "util/camera.h"
 #include "util/timer.h"
 #include "util/navigation.h"
+#include "util/pathservice.h"
 #include "util/animation.h"
 #include "geometry/geometry.h"
 #include "geometry/transform.h"
 #include "geometry/voronoi.h"
 #include "util/image.h"
+#include "util/heightpyramid.h"
 #include "graphics/shader.h"
 #include "graphics/mesh.h"
 #include "graphics/texture.h"
@@ -39,6 +42,7 @@ class UserDirectory {
 public:
 	std::string settings = "";
 	std::string saves = "";
+	std::string cache = "";
 public:
 	bool locate(const char *base);
 private:
@@ -48,6 +52,7 @@ private:
 enum class EngineState {
 	TITLE,
 	NEW_CAMPAIGN,
+	GENERATING_CAMPAIGN,
 	LOADING_CAMPAIGN,
 	RUNNING_CAMPAIGN,
 	BATTLE,
@@ -80,6 +85,7 @@ private:
 	void load_shaders();
 	void load_module();
 	void update_main_menu();
+	void update_generation_menu();
 private:
 	void run_campaign();
 	void update_campaign_menu();
@@ -30,6 +30,7 @@
 
 #include <math.h>
 #include <assert.h>
+#include <string.h>
 
 #include <algorithm>
 #include <random>
@@ -2248,3 +2249,243 @@ void FastNoise::SingleGradientPerturb(unsigned char offset, FN_DECIMAL warpAmp,
 	x += Lerp(lx0x, lx1x, ys) * warpAmp;
 	y += Lerp(ly0x, ly1x, ys) * warpAmp;
 }
+
+// Batched 2D noise
+// The vector code repeats the scalar expressions operation for operation (no fused multiply-add),
+// so every lane rounds exactly like SingleSimplex and SingleGradientPerturb do
+#if !defined(FN_USE_DOUBLES) && defined(__GNUC__) && defined(__x86_64__)
+#define FN_BATCH_SIMD
+
+// the helpers below are always inlined, so passing 256 bit vectors by value never reaches an ABI boundary
+#pragma GCC diagnostic ignored "-Wpsabi"
+
+typedef float FN_VEC __attribute__((vector_size(32)));
+typedef int FN_IVEC __attribute__((vector_size(32)));
+static const int FN_LANES = 8;
+
+struct BatchSettings
+{
+	const unsigned char* perm;
+	const unsigned char* perm12;
+	int octaves;
+	int interp;
+	float frequency;
+	float lacunarity;
+	float gain;
+	float fractalBounding;
+	float perturbFrequency;
+	float perturbAmp;
+};
+
+#define FN_INLINE static inline __attribute__((always_inline))
+
+FN_INLINE FN_VEC VecFloat(FN_IVEC v) { return __builtin_convertvector(v, FN_VEC); }
+
+FN_INLINE FN_IVEC VecFastFloor(FN_VEC f)
+{
+	// (int)f truncates, negative values take one more step down like FastFloor
+	return __builtin_convertvector(f, FN_IVEC) + (f < 0);
+}
+
+FN_INLINE FN_IVEC VecIndex2D_256(const BatchSettings& s, unsigned char offset, FN_IVEC x, FN_IVEC y)
+{
+	FN_IVEC index;
+	for (int k = 0; k < FN_LANES; k++)
+		index[k] = s.perm[(x[k] & 0xff) + s.perm[(y[k] & 0xff) + offset]];
+	return index;
+}
+
+FN_INLINE FN_IVEC VecIndex2D_12(const BatchSettings& s, unsigned char offset, FN_IVEC x, FN_IVEC y)
+{
+	FN_IVEC index;
+	for (int k = 0; k < FN_LANES; k++)
+		index[k] = s.perm12[(x[k] & 0xff) + s.perm[(y[k] & 0xff) + offset]];
+	return index;
+}
+
+FN_INLINE FN_VEC VecLookup(const FN_DECIMAL* table, FN_IVEC index)
+{
+	FN_VEC v;
+	for (int k = 0; k < FN_LANES; k++)
+		v[k] = table[index[k]];
+	return v;
+}
+
+FN_INLINE FN_VEC VecLerp(FN_VEC a, FN_VEC b, FN_VEC t) { return a + t * (b - a); }
+FN_INLINE FN_VEC VecInterpHermite(FN_VEC t) { return t*t*(3 - 2 * t); }
+FN_INLINE FN_VEC VecInterpQuintic(FN_VEC t) { return t*t*t*(t*(t * 6 - 15) + 10); }
+
+FN_INLINE FN_VEC VecGradCoord2D(const BatchSettings& s, unsigned char offset, FN_IVEC x, FN_IVEC y, FN_VEC xd, FN_VEC yd)
+{
+	FN_IVEC lutPos = VecIndex2D_12(s, offset, x, y);
+
+	return xd*VecLookup(GRAD_X, lutPos) + yd*VecLookup(GRAD_Y, lutPos);
+}
+
+FN_INLINE FN_VEC VecSingleSimplex(const BatchSettings& s, unsigned char offset, FN_VEC x, FN_VEC y)
+{
+	FN_VEC t = (x + y) * F2;
+	FN_IVEC i = VecFastFloor(x + t);
+	FN_IVEC j = VecFastFloor(y + t);
+
+	t = VecFloat(i + j) * G2;
+	FN_VEC X0 = VecFloat(i) - t;
+	FN_VEC Y0 = VecFloat(j) - t;
+
+	FN_VEC x0 = x - X0;
+	FN_VEC y0 = y - Y0;
+
+	FN_IVEC i1 = (x0 > y0) & 1;
+	FN_IVEC j1 = 1 - i1;
+
+	FN_VEC x1 = x0 - VecFloat(i1) + G2;
+	FN_VEC y1 = y0 - VecFloat(j1) + G2;
+	FN_VEC x2 = x0 - 1 + 2*G2;
+	FN_VEC y2 = y0 - 1 + 2*G2;
+
+	const FN_VEC zero = {};
+
+	t = FN_DECIMAL(0.5) - x0*x0 - y0*y0;
+	FN_IVEC outside = t < 0;
+	t *= t;
+	FN_VEC n0 = outside ? zero : t * t * VecGradCoord2D(s, offset, i, j, x0, y0);
+
+	t = FN_DECIMAL(0.5) - x1*x1 - y1*y1;
+	outside = t < 0;
+	t *= t;
+	FN_VEC n1 = outside ? zero : t*t*VecGradCoord2D(s, offset, i + i1, j + j1, x1, y1);
+
+	t = FN_DECIMAL(0.5) - x2*x2 - y2*y2;
+	outside = t < 0;
+	t *= t;
+	FN_VEC n2 = outside ? zero : t*t*VecGradCoord2D(s, offset, i + 1, j + 1, x2, y2);
+
+	return 70 * (n0 + n1 + n2);
+}
+
+FN_INLINE void VecSingleGradientPerturb(const BatchSettings& s, unsigned char offset, FN_DECIMAL warpAmp, FN_DECIMAL frequency, FN_VEC& x, FN_VEC& y)
+{
+	FN_VEC xf = x * frequency;
+	FN_VEC yf = y * frequency;
+
+	FN_IVEC x0 = VecFastFloor(xf);
+	FN_IVEC y0 = VecFastFloor(yf);
+	FN_IVEC x1 = x0 + 1;
+	FN_IVEC y1 = y0 + 1;
+
+	FN_VEC xs, ys;
+	switch (s.interp)
+	{
+	default:
+	case FastNoise::Linear:
+		xs = xf - VecFloat(x0);
+		ys = yf - VecFloat(y0);
+		break;
+	case FastNoise::Hermite:
+		xs = VecInterpHermite(xf - VecFloat(x0));
+		ys = VecInterpHermite(yf - VecFloat(y0));
+		break;
+	case FastNoise::Quintic:
+		xs = VecInterpQuintic(xf - VecFloat(x0));
+		ys = VecInterpQuintic(yf - VecFloat(y0));
+		break;
+	}
+
+	FN_IVEC lutPos0 = VecIndex2D_256(s, offset, x0, y0);
+	FN_IVEC lutPos1 = VecIndex2D_256(s, offset, x1, y0);
+
+	FN_VEC lx0x = VecLerp(VecLookup(CELL_2D_X, lutPos0), VecLookup(CELL_2D_X, lutPos1), xs);
+	FN_VEC ly0x = VecLerp(VecLookup(CELL_2D_Y, lutPos0), VecLookup(CELL_2D_Y, lutPos1), xs);
+
+	lutPos0 = VecIndex2D_256(s, offset, x0, y1);
+	lutPos1 = VecIndex2D_256(s, offset, x1, y1);
+
+	FN_VEC lx1x = VecLerp(VecLookup(CELL_2D_X, lutPos0), VecLookup(CELL_2D_X, lutPos1), xs);
+	FN_VEC ly1x = VecLerp(VecLookup(CELL_2D_Y, lutPos0), VecLookup(CELL_2D_Y, lutPos1), xs);
+
+	x += VecLerp(lx0x, lx1x, ys) * warpAmp;
+	y += VecLerp(ly0x, ly1x, ys) * warpAmp;
+}
+
+// Compiled once for AVX2 and once for the baseline SSE2, the best one is picked when the program loads
+// AVX2 does not include FMA so the multiply and add stay separate in both versions
+__attribute__((target_clones("avx2", "default")))
+static void PerturbedSimplexFractalFBMBatch(const BatchSettings& s, FN_DECIMAL* xs, FN_DECIMAL* ys, FN_DECIMAL* out, int count)
+{
+	for (int n = 0; n + FN_LANES <= count; n += FN_LANES)
+	{
+		FN_VEC x, y;
+		memcpy(&x, xs + n, sizeof(x));
+		memcpy(&y, ys + n, sizeof(y));
+
+		// GradientPerturbFractal
+		FN_DECIMAL amp = s.perturbAmp * s.fractalBounding;
+		FN_DECIMAL freq = s.perturbFrequency;
+		int i = 0;
+
+		VecSingleGradientPerturb(s, s.perm[0], amp, s.frequency, x, y);
+
+		while (++i < s.octaves)
+		{
+			freq *= s.lacunarity;
+			amp *= s.gain;
+			VecSingleGradientPerturb(s, s.perm[i], amp, freq, x, y);
+		}
+
+		memcpy(xs + n, &x, sizeof(x));
+		memcpy(ys + n, &y, sizeof(y));
+
+		// GetNoise with SingleSimplexFractalFBM
+		x *= s.frequency;
+		y *= s.frequency;
+
+		FN_VEC sum = VecSingleSimplex(s, s.perm[0], x, y);
+		amp = 1;
+		i = 0;
+
+		while (++i < s.octaves)
+		{
+			x *= s.lacunarity;
+			y *= s.lacunarity;
+
+			amp *= s.gain;
+			sum += VecSingleSimplex(s, s.perm[i], x, y) * amp;
+		}
+
+		FN_VEC result = sum * s.fractalBounding;
+		memcpy(out + n, &result, sizeof(result));
+	}
+}
+#endif
+
+void FastNoise::GetPerturbedNoiseBatch(FN_DECIMAL* x, FN_DECIMAL* y, FN_DECIMAL* out, int count) const
+{
+	int done = 0;
+
+#ifdef FN_BATCH_SIMD
+	if (m_noiseType == SimplexFractal && m_fractalType == FBM)
+	{
+		BatchSettings settings;
+		settings.perm = m_perm;
+		settings.perm12 = m_perm12;
+		settings.octaves = m_octaves;
+		settings.interp = m_interp;
+		settings.frequency = m_frequency;
+		settings.lacunarity = m_lacunarity;
+		settings.gain = m_gain;
+		settings.fractalBounding = m_fractalBounding;
+		settings.perturbFrequency = m_perturbFrequency;
+		settings.perturbAmp = m_gradientPerturbAmp;
+
+		done = count - count % FN_LANES;
+		PerturbedSimplexFractalFBMBatch(settings, x, y, out, done);
+	}
+#endif
+
+	// remainder and noise types without a batched version
+	for (int i = done; i < count; i++)
+	{
+		GradientPerturbFractal(x[i], y[i]);
+		out[i] = GetNoise(x[i], y[i]);
+	}
+}
@@ -185,6 +185,12 @@ public:
 	void GradientPerturb(FN_DECIMAL& x, FN_DECIMAL& y) const;
 	void GradientPerturbFractal(FN_DECIMAL& x, FN_DECIMAL& y) const;
 
+	// Same as calling GradientPerturbFractal(x[i], y[i]) followed by out[i] = GetNoise(x[i], y[i]) for every point
+	// x and y are perturbed in place
+	// SimplexFractal FBM is evaluated 8 points at a time with SIMD and gives bit identical results,
+	// other noise types use the scalar functions
+	void GetPerturbedNoiseBatch(FN_DECIMAL* x, FN_DECIMAL* y, FN_DECIMAL* out, int count) const;
+
 	//3D
 	FN_DECIMAL GetValue(FN_DECIMAL x, FN_DECIMAL y, FN_DECIMAL z) const;
 	FN_DECIMAL GetValueFractal(FN_DECIMAL x, FN_DECIMAL y, FN_DECIMAL z) const;
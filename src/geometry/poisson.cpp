@@ -0,0 +1,198 @@
+#include <vector>
+#include <random>
+#include <limits>
+#include <cmath>
+#include <glm/glm.hpp>
+#include <glm/vec2.hpp>
+
+#include "geometry.h"
+#include "poisson.h"
+
+namespace geom {
+
+static const int TILE_CELLS = 32; // tile size in grid cells
+static const int NEIGHBORHOOD = 2; // grid cells to search for points that are too close
+static const int SEED_RING = 3; // grid cells around a tile with points that can spawn points in the tile
+static const float TWO_PI = 6.28318530718f;
+
+// background grid where each cell holds at most one point
+struct PoissonGrid {
+	int width = 0;
+	int height = 0;
+	float cell_size = 0.f;
+	glm::vec2 origin = {};
+	std::vector<glm::vec2> points; // empty cells are at infinity so they never conflict
+
+	int column(float x) const
+	{
+		return std::clamp(int(std::floor((x - origin.x) / cell_size)), 0, width - 1);
+	}
+	int row(float y) const
+	{
+		return std::clamp(int(std::floor((y - origin.y) / cell_size)), 0, height - 1);
+	}
+	bool empty(int x, int y) const
+	{
+		return std::isinf(points[x + y * width].x);
+	}
+	bool conflicts(const glm::vec2 &point, float min_distance) const
+	{
+		const int x = column(point.x);
+		const int y = row(point.y);
+		const int min_x = std::max(x - NEIGHBORHOOD, 0);
+		const int min_y = std::max(y - NEIGHBORHOOD, 0);
+		const int max_x = std::min(x + NEIGHBORHOOD, width - 1);
+		const int max_y = std::min(y + NEIGHBORHOOD, height - 1);
+		const float min_distance2 = min_distance * min_distance;
+		for (int y = min_y; y <= max_y; y++) {
+			for (int x = min_x; x <= max_x; x++) {
+				const glm::vec2 d = points[x + y * width] - point;
+				if (glm::dot(d, d) < min_distance2) {
+					return true;
+				}
+			}
+		}
+		return false;
+	}
+};
+
+// bounds of a tile in grid cells, the maximum is exclusive
+struct PoissonTile {
+	int min_x, min_y;
+	int max_x, max_y;
+};
+
+static uint32_t tile_seed(uint32_t seed, int x, int y)
+{
+	// splitmix64 finalizer
+	uint64_t z = (uint64_t(seed) << 32) ^ (uint64_t(uint32_t(x)) << 16) ^ uint64_t(uint32_t(y)) ^ 0x9e3779b97f4a7c15ULL;
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	return uint32_t(z ^ (z >> 31));
+}
+
+// Bridson's algorithm inside a single tile
+static void fill_tile(PoissonGrid &grid, const PoissonTile &tile, const Rectangle &area, float min_distance, uint32_t seed, int attempts, std::vector<glm::vec2> &output)
+{
+	std::mt19937 gen(seed);
+	std::uniform_real_distribution<float> unit(0.f, 1.f);
+
+	const Rectangle bounds = {
+		glm::max(grid.origin + grid.cell_size * glm::vec2(tile.min_x, tile.min_y), area.min),
+		glm::min(grid.origin + grid.cell_size * glm::vec2(tile.max_x, tile.max_y), area.max)
+	};
+
+	// points of tiles filled before that are close enough to spawn points in this tile
+	std::vector<glm::vec2> active;
+	const int min_x = std::max(tile.min_x - SEED_RING, 0);
+	const int min_y = std::max(tile.min_y - SEED_RING, 0);
+	const int max_x = std::min(tile.max_x + SEED_RING, grid.width);
+	const int max_y = std::min(tile.max_y + SEED_RING, grid.height);
+	for (int y = min_y; y < max_y; y++) {
+		for (int x = min_x; x < max_x; x++) {
+			if (!grid.empty(x, y)) {
+				active.push_back(grid.points[x + y * grid.width]);
+			}
+		}
+	}
+
+	// only cells of this tile are written to
+	auto inside = [&](const glm::vec2 &point) -> bool {
+		const int x = grid.column(point.x);
+		const int y = grid.row(point.y);
+		return x >= tile.min_x && x < tile.max_x && y >= tile.min_y && y < tile.max_y;
+	};
+	auto insert = [&](const glm::vec2 &point) {
+		grid.points[grid.column(point.x) + grid.row(point.y) * grid.width] = point;
+		active.push_back(point);
+		output.push_back(point);
+	};
+
+	// the first tile has nothing to continue from
+	if (active.empty()) {
+		for (int i = 0; i < attempts; i++) {
+			glm::vec2 point = bounds.min + (bounds.max - bounds.min) * glm::vec2(unit(gen), unit(gen));
+			if (inside(point) && !grid.conflicts(point, min_distance)) {
+				insert(point);
+				break;
+			}
+		}
+	}
+
+	while (!active.empty()) {
+		std::uniform_int_distribution<size_t> pick(0, active.size() - 1);
+		const size_t index = pick(gen);
+		const glm::vec2 origin = active[index];
+
+		bool found = false;
+		for (int i = 0; i < attempts; i++) {
+			// uniform in the ring between min_distance and twice that
+			const float radius = min_distance * std::sqrt(1.f + 3.f * unit(gen));
+			const float angle = TWO_PI * unit(gen);
+			const glm::vec2 point = origin + radius * glm::vec2(std::cos(angle), std::sin(angle));
+			if (point.x < area.min.x || point.y < area.min.y || point.x > area.max.x || point.y > area.max.y || !inside(point)) {
+				continue;
+			}
+			if (!grid.conflicts(point, min_distance)) {
+				insert(point);
+				found = true;
+				break;
+			}
+		}
+
+		if (!found) {
+			active[index] = active.back();
+			active.pop_back();
+		}
+	}
+}
+
+std::vector<glm::vec2> poisson_disk_points(const Rectangle &area, float min_distance, uint32_t seed, int attempts)
+{
+	// every cell is small enough that it can only hold one point
+	PoissonGrid grid;
+	grid.cell_size = min_distance / std::sqrt(2.f);
+	grid.origin = area.min;
+	grid.width = std::max(int(std::ceil((area.max.x - area.min.x) / grid.cell_size)), 1);
+	grid.height = std::max(int(std::ceil((area.max.y - area.min.y) / grid.cell_size)), 1);
+	grid.points.assign(grid.width * grid.height, glm::vec2(std::numeric_limits<float>::infinity()));
+
+	// tiles are spread evenly so none of them is thinner than the neighborhood that is searched
+	const int columns = std::max(grid.width / TILE_CELLS, 1);
+	const int rows = std::max(grid.height / TILE_CELLS, 1);
+	std::vector<PoissonTile> tiles(columns * rows);
+	for (int y = 0; y < rows; y++) {
+		for (int x = 0; x < columns; x++) {
+			auto &tile = tiles[x + y * columns];
+			tile.min_x = x * grid.width / columns;
+			tile.min_y = y * grid.height / rows;
+			tile.max_x = (x + 1) * grid.width / columns;
+			tile.max_y = (y + 1) * grid.height / rows;
+		}
+	}
+
+	std::vector<std::vector<glm::vec2>> tile_points(tiles.size());
+
+	for (int pass = 0; pass < 4; pass++) {
+		const int offset_x = pass & 1;
+		const int offset_y = pass >> 1;
+		const int pass_columns = (columns - offset_x + 1) / 2;
+		const int pass_rows = (rows - offset_y + 1) / 2;
+		#pragma omp parallel for schedule(dynamic)
+		for (int i = 0; i < pass_columns * pass_rows; i++) {
+			const int x = offset_x + 2 * (i % pass_columns);
+			const int y = offset_y + 2 * (i / pass_columns);
+			const int index = x + y * columns;
+			fill_tile(grid, tiles[index], area, min_distance, tile_seed(seed, x, y), attempts, tile_points[index]);
+		}
+	}
+
+	std::vector<glm::vec2> points;
+	for (const auto &tile : tile_points) {
+		points.insert(points.end(), tile.begin(), tile.end());
+	}
+
+	return points;
+}
+
+};
@@ -0,0 +1,12 @@
+#pragma once
+#include <vector>
+
+namespace geom {
+
+// blue noise points in an area with at least min_distance between any two of them
+// the area is split in tiles that are filled in four passes like a checkerboard, tiles in the same pass never touch so they are filled in parallel
+// a tile continues from the points of the tiles next to it that were filled before so there are no gaps or conflicts at the seams
+// every tile has its own random generator seeded from the seed and the tile, the points only depend on the seed and not on the number of threads
+std::vector<glm::vec2> poisson_disk_points(const Rectangle &area, float min_distance, uint32_t seed, int attempts = 30);
+
+};
@@ -1,5 +1,5 @@
 #include <vector>
-#include <set>
+#include <algorithm>
 #include <array>
 #include <glm/glm.hpp>
 #include <glm/vec3.hpp>
@@ -20,6 +20,8 @@
 
 namespace geom {
 	
+static void generate_diagram(const std::vector<jcv_point> &points, const jcv_rect &rect, uint8_t relaxations, std::vector<VoronoiCell> &cells, std::vector<VoronoiVertex> &vertices, std::vector<VoronoiEdge> &edges);
+static void generate_strips(const std::vector<jcv_point> &points, const jcv_rect &rect, uint8_t relaxations, std::vector<VoronoiCell> &cells, std::vector<VoronoiVertex> &vertices, std::vector<VoronoiEdge> &edges);
 static void relax_points(const jcv_diagram *diagram, std::vector<jcv_point> &points);
 static void adapt_cells(const jcv_diagram *diagram, std::vector<VoronoiCell> &cells);
 static void adapt_vertices(const jcv_diagram *diagram, std::vector<VoronoiVertex> &vertices);
@@ -29,10 +31,16 @@ bool triangle_overlaps_rectangle(const glm::vec2 &a, const glm::vec2 &b, const g
 
 static const size_t CELL_REGION_RES = 256;
 
+// from this many sites on the diagram is built in strips
+static const size_t LARGE_SITE_COUNT = 1 << 18;
+static const size_t STRIP_SITE_COUNT = 1 << 16;
+
+static const uint32_t FLAT_VORONOI_MAGIC = 0x564f524e; // "NROV"
+static const uint32_t FLAT_VORONOI_VERSION = 1; // change if the flat layout changes
+static const size_t FLAT_ALIGNMENT = 64;
+
 void VoronoiGraph::generate(const std::vector<glm::vec2> &locations, const Bounding<glm::vec2> &bounds, uint8_t relaxations)
 {
-	m_bounds = bounds;
-
 	clear();
 
 	// import points
@@ -48,152 +56,443 @@ void VoronoiGraph::generate(const std::vector<glm::vec2> &locations, const Bound
 		{ bounds.max.x, bounds.max.y},
 	};
 
-	// generate the diagram
-	jcv_diagram diagram;
-	memset(&diagram, 0, sizeof(jcv_diagram));
-	jcv_diagram_generate(points.size(), points.data(), &rect, 0, &diagram);
-
-	// relax the diagram if requested
-	for (uint8_t i = 0; i < relaxations; i++) {
-		std::vector<jcv_point> relaxed_points;
-		relax_points(&diagram, relaxed_points);
-		jcv_diagram_generate(relaxed_points.size(), relaxed_points.data(), &rect, 0, &diagram);
+	if (points.size() >= LARGE_SITE_COUNT) {
+		generate_strips(points, rect, relaxations, cells, vertices, edges);
+	} else {
+		generate_diagram(points, rect, relaxations, cells, vertices, edges);
 	}
 
-	// vertex data
-	jcv_diagram_generate_vertices(&diagram);
-
-	adapt_cells(&diagram, cells);
+	build_flat_layout(bounds);
+}
+	
+void VoronoiGraph::clear()
+{
+	cells.clear();
+	vertices.clear();
+	edges.clear();
 
-	adapt_vertices(&diagram, vertices);
+	m_flat.clear();
+	m_topology = {};
 
-	pair_duality(&diagram, cells, vertices);
+	m_cell_raster.clear();
+	m_raster_resolution = 0;
+}
+	
+void VoronoiGraph::build_cell_raster(uint32_t resolution)
+{
+	const auto &bounds = m_topology.bounds;
 
-	adapt_edges(&diagram, cells, vertices, edges);
+	m_raster_resolution = resolution;
+	m_raster_scale = (bounds.max - bounds.min) / float(resolution);
 
-	jcv_diagram_free(&diagram);
+	// cell at each pixel corner
+	// the last row and column of corners are skipped since they are on the edge of the graph
+	std::vector<uint32_t> corners(resolution * resolution);
+	#pragma omp parallel for schedule(static)
+	for (int y = 0; y < resolution; y++) {
+		for (int x = 0; x < resolution; x++) {
+			glm::vec2 position = bounds.min + m_raster_scale * glm::vec2(x, y);
+			uint32_t cell = VORONOI_NO_CELL;
+			m_topology.cell_at(position, cell);
+			corners[x + y * resolution] = cell;
+		}
+	}
 
-	// create data to serialize graph
-	for (const auto &edge : edges) {
-		auto cell_connection = std::make_pair(edge.left_cell->index, edge.right_cell->index);
-		auto vertex_connection = std::make_pair(edge.left_vertex->index, edge.right_vertex->index);
-		m_connected_cells[edge.index] = cell_connection;
-		m_connected_vertices[edge.index] = vertex_connection;
+	// cells are convex so a pixel is inside a cell if all of its corners are
+	m_cell_raster.assign(resolution * resolution, VORONOI_NO_CELL);
+	const int last = resolution - 1;
+	#pragma omp parallel for schedule(static)
+	for (int y = 0; y < last; y++) {
+		for (int x = 0; x < last; x++) {
+			uint32_t cell = corners[x + y * resolution];
+			bool inside = cell == corners[(x + 1) + y * resolution]
+				&& cell == corners[x + (y + 1) * resolution]
+				&& cell == corners[(x + 1) + (y + 1) * resolution];
+			if (inside) {
+				m_cell_raster[x + y * resolution] = cell;
+			}
+		}
 	}
+}
 	
-	for (const auto &cell : cells) {
-		for (const auto &vertex : cell.vertices) {
-			auto connection = std::make_pair(cell.index, vertex->index);
-			m_cell_vertex_connections.push_back(connection);
+uint32_t VoronoiGraph::find_cell(const glm::vec2 &position) const
+{
+	if (m_raster_resolution > 0) {
+		glm::vec2 pixel = (position - m_topology.bounds.min) / m_raster_scale;
+		int x = floor(pixel.x);
+		int y = floor(pixel.y);
+		if (x >= 0 && y >= 0 && x < m_raster_resolution && y < m_raster_resolution) {
+			uint32_t cell = m_cell_raster[x + y * m_raster_resolution];
+			if (cell != VORONOI_NO_CELL) {
+				return cell;
+			}
 		}
 	}
 
-	// spatial hash cells
-	create_spatial_map();
+	uint32_t cell = VORONOI_NO_CELL;
+	m_topology.cell_at(position, cell);
+
+	return cell;
 }
 	
-void VoronoiGraph::clear()
+VoronoiSearchResult VoronoiGraph::cell_at(const glm::vec2 &position) const
 {
-	cells.clear();
-	vertices.clear();
-	edges.clear();
+	VoronoiSearchResult result = { false, nullptr };
 
-	m_connected_cells.clear();
-	m_connected_vertices.clear();
-	m_cell_vertex_connections.clear();
+	uint32_t index = find_cell(position);
+	if (index != VORONOI_NO_CELL) {
+		result.found = true;
+		result.cell = &cells[index];
+	}
 
-	m_spatial_map.clear();
+	return result;
 }
 	
-VoronoiSearchResult VoronoiGraph::cell_at(const glm::vec2 &position) const
+void VoronoiGraph::cells_at(std::span<const glm::vec2> positions, std::span<uint32_t> indices) const
 {
-	VoronoiSearchResult result = { false, nullptr };
+	// only worth spreading over threads for big batches
+	#pragma omp parallel for schedule(static) if(positions.size() > 4096)
+	for (size_t i = 0; i < positions.size(); i++) {
+		indices[i] = find_cell(positions[i]);
+	}
+}
+	
+bool VoronoiGraph::load_flat_layout(std::vector<uint8_t> &&layout)
+{
+	clear();
 
-	int x = floor(position.x / m_region_scale.x);
-	int y = floor(position.y / m_region_scale.y);
+	m_flat = std::move(layout);
 
-	int index = x + y * CELL_REGION_RES;
-	if (index < 0 || index >= m_spatial_map.size()) {
-		return result;
+	if (!m_topology.map(m_flat.data(), m_flat.size())) {
+		clear();
+		return false;
 	}
 
-	const auto &region = m_spatial_map[index];
+	create_nodes();
+
+	return true;
+}
+	
+bool VoronoiTopology::edge_between(uint32_t a, uint32_t b, uint32_t &edge) const
+{
+	// the edge borders a cell of both vertices so only the edges of the cells around one vertex are searched
+	for (uint32_t cell : vertex_cells[a]) {
+		for (uint32_t candidate : cell_edges[cell]) {
+			const uint32_t left = edge_vertices[2*candidate];
+			const uint32_t right = edge_vertices[2*candidate+1];
+			if ((left == a && right == b) || (left == b && right == a)) {
+				edge = candidate;
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+bool VoronoiTopology::cell_at(const glm::vec2 &position, uint32_t &cell) const
+{
+	int x = floor(position.x / region_scale.x);
+	int y = floor(position.y / region_scale.y);
+
+	int index = x + y * region_resolution;
+	if (index < 0 || index >= region_cells.size()) {
+		return false;
+	}
 
 	// find closest cell to point within region
+	bool found = false;
 	float min_distance = std::numeric_limits<float>::max();
-	for (const auto &cell : region.cells) {
-		float distance = glm::distance(cell->center, position);
+	for (uint32_t candidate : region_cells[index]) {
+		float distance = glm::distance(cell_centers[candidate], position);
 		if (distance < min_distance) {
 			min_distance = distance;
-			result.cell = cell;
-			result.found = true;
+			cell = candidate;
+			found = true;
 		}
 	}
 
-	return result;
+	return found;
+}
+	
+template <typename T>
+static bool map_array(const uint8_t *data, const FlatVoronoiHeader *header, FlatVoronoiArray array, size_t count, std::span<const T> &output)
+{
+	const auto &section = header->sections[array];
+	// written so a huge count or offset can not overflow
+	if (section.count != count || section.offset % alignof(T) != 0 || section.offset > header->size || section.count > (header->size - section.offset) / sizeof(T)) {
+		return false;
+	}
+
+	output = { reinterpret_cast<const T*>(data + section.offset), count };
+
+	return true;
 }
 	
-void VoronoiGraph::unserialize_nodes()
+// false if an index refers to a node that does not exist
+static bool indices_below(std::span<const uint32_t> indices, size_t limit)
+{
+	for (uint32_t index : indices) {
+		if (index >= limit) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// the items of each node are referenced by index so they are only accepted if they are below the item limit
+static bool map_adjacency(const uint8_t *data, const FlatVoronoiHeader *header, FlatVoronoiArray offsets, FlatVoronoiArray items, size_t count, size_t item_limit, AdjacencyList &output)
 {
-	// connect with pointers
-	for (const auto &connection : m_connected_cells) {
-		const auto &cell_pair = connection.second;
-		VoronoiEdge *edge = &edges[connection.first];
-		VoronoiCell *left_cell = &cells[cell_pair.first];
-		VoronoiCell *right_cell = &cells[cell_pair.second];
-		edge->left_cell = left_cell;
-		edge->right_cell = right_cell;
-		left_cell->edges.push_back(edge);
-		left_cell->neighbors.push_back(right_cell);
-		right_cell->edges.push_back(edge);
-		right_cell->neighbors.push_back(left_cell);
-	}
-	// vertex connections
-	for (const auto &connection : m_connected_vertices) {
-		const auto &vertex_pair = connection.second;
-		VoronoiEdge *edge = &edges[connection.first];
-		VoronoiVertex *left_vertex = &vertices[vertex_pair.first];
-		VoronoiVertex *right_vertex = &vertices[vertex_pair.second];
-		edge->left_vertex = left_vertex;
-		edge->right_vertex = right_vertex;
-		left_vertex->adjacent.push_back(right_vertex);
-		right_vertex->adjacent.push_back(left_vertex);
-	}
-	// vertex cell connections
-	for (const auto &connection : m_cell_vertex_connections) {
-		VoronoiCell *cell = &cells[connection.first];
-		VoronoiVertex *vertex = &vertices[connection.second];
-		cell->vertices.push_back(vertex);
-		vertex->cells.push_back(cell);
+	if (!map_array(data, header, offsets, count + 1, output.offsets)) {
+		return false;
 	}
+	if (output.offsets.front() != 0) {
+		return false;
+	}
+	// the lists of the nodes follow each other
+	for (size_t i = 0; i < count; i++) {
+		if (output.offsets[i] > output.offsets[i+1]) {
+			return false;
+		}
+	}
+	if (!map_array(data, header, items, output.offsets.back(), output.items)) {
+		return false;
+	}
+
+	return indices_below(output.items, item_limit);
 }
 	
-void VoronoiGraph::create_spatial_map()
+bool VoronoiTopology::map(const uint8_t *data, size_t size)
 {
-	m_spatial_map.resize(CELL_REGION_RES * CELL_REGION_RES);
-	m_region_scale = {
-		glm::distance(m_bounds.min.x, m_bounds.max.x) / float(CELL_REGION_RES),
-		glm::distance(m_bounds.min.y, m_bounds.max.y) / float(CELL_REGION_RES)
+	*this = {};
+
+	const FlatVoronoiHeader *header = reinterpret_cast<const FlatVoronoiHeader*>(data);
+	if (size < sizeof(FlatVoronoiHeader) || header->magic != FLAT_VORONOI_MAGIC || header->version != FLAT_VORONOI_VERSION || header->size > size) {
+		return false;
+	}
+
+	// the file could be corrupt so the bounds of the arrays and every index in them are checked
+	const size_t cell_count = header->cell_count;
+	const size_t vertex_count = header->vertex_count;
+	const size_t edge_count = header->edge_count;
+	const size_t region_count = size_t(header->region_resolution) * header->region_resolution;
+
+	bool valid = map_array(data, header, FLAT_CELL_CENTERS, cell_count, cell_centers)
+		&& map_array(data, header, FLAT_VERTEX_POSITIONS, vertex_count, vertex_positions)
+		&& map_adjacency(data, header, FLAT_CELL_NEIGHBOR_OFFSETS, FLAT_CELL_NEIGHBOR_ITEMS, cell_count, cell_count, cell_neighbors)
+		&& map_adjacency(data, header, FLAT_CELL_VERTEX_OFFSETS, FLAT_CELL_VERTEX_ITEMS, cell_count, vertex_count, cell_vertices)
+		&& map_adjacency(data, header, FLAT_CELL_EDGE_OFFSETS, FLAT_CELL_EDGE_ITEMS, cell_count, edge_count, cell_edges)
+		&& map_adjacency(data, header, FLAT_VERTEX_ADJACENT_OFFSETS, FLAT_VERTEX_ADJACENT_ITEMS, vertex_count, vertex_count, vertex_adjacent)
+		&& map_adjacency(data, header, FLAT_VERTEX_CELL_OFFSETS, FLAT_VERTEX_CELL_ITEMS, vertex_count, cell_count, vertex_cells)
+		&& map_array(data, header, FLAT_EDGE_CELLS, 2 * edge_count, edge_cells)
+		&& indices_below(edge_cells, cell_count)
+		&& map_array(data, header, FLAT_EDGE_VERTICES, 2 * edge_count, edge_vertices)
+		&& indices_below(edge_vertices, vertex_count)
+		&& map_adjacency(data, header, FLAT_REGION_OFFSETS, FLAT_REGION_ITEMS, region_count, cell_count, region_cells);
+
+	if (!valid) {
+		*this = {};
+		return false;
+	}
+
+	bounds = header->bounds;
+	region_scale = header->region_scale;
+	region_resolution = header->region_resolution;
+
+	return true;
+}
+	
+// appends arrays to the flat layout
+class FlatLayoutWriter {
+public:
+	FlatLayoutWriter(std::vector<uint8_t> &buffer)
+		: m_buffer(buffer)
+	{
+		m_buffer.assign(sizeof(FlatVoronoiHeader), 0);
+	}
+	FlatVoronoiHeader& header()
+	{
+		return *reinterpret_cast<FlatVoronoiHeader*>(m_buffer.data());
+	}
+	template <typename T>
+	void write(FlatVoronoiArray array, const std::vector<T> &data)
+	{
+		// pad to alignment
+		m_buffer.resize((m_buffer.size() + FLAT_ALIGNMENT - 1) / FLAT_ALIGNMENT * FLAT_ALIGNMENT, 0);
+
+		const size_t offset = m_buffer.size();
+		m_buffer.resize(offset + data.size() * sizeof(T));
+		if (!data.empty()) {
+			memcpy(m_buffer.data() + offset, data.data(), data.size() * sizeof(T));
+		}
+
+		header().sections[array] = { offset, data.size() };
+	}
+	template <typename Node, typename Member>
+	void write_adjacency(FlatVoronoiArray offsets, FlatVoronoiArray items, const std::vector<Node> &nodes, Member member)
+	{
+		std::vector<uint32_t> starts(nodes.size() + 1);
+		starts[0] = 0;
+		for (size_t i = 0; i < nodes.size(); i++) {
+			starts[i+1] = starts[i] + (nodes[i].*member).size();
+		}
+
+		std::vector<uint32_t> indices;
+		indices.reserve(starts.back());
+		for (const auto &node : nodes) {
+			for (const auto &other : node.*member) {
+				indices.push_back(other->index);
+			}
+		}
+
+		write(offsets, starts);
+		write(items, indices);
+	}
+private:
+	std::vector<uint8_t> &m_buffer;
+};
+	
+void VoronoiGraph::build_flat_layout(const Bounding<glm::vec2> &bounds)
+{
+	const glm::vec2 scale = {
+		glm::distance(bounds.min.x, bounds.max.x) / float(CELL_REGION_RES),
+		glm::distance(bounds.min.y, bounds.max.y) / float(CELL_REGION_RES)
 	};
 
-	glm::vec2 offset = m_bounds.min;
+	// spatial hash cells
+	std::vector<Rectangle> areas(CELL_REGION_RES * CELL_REGION_RES);
+	glm::vec2 offset = bounds.min;
 	for (int i = 0; i < CELL_REGION_RES; i++) {
 		for (int j = 0; j < CELL_REGION_RES; j++) {
-			Rectangle area = { offset, offset + m_region_scale };
-			m_spatial_map[i + j * CELL_REGION_RES].bounds = area;
-			offset.y += m_region_scale.y;
+			areas[i + j * CELL_REGION_RES] = { offset, offset + scale };
+			offset.y += scale.y;
 		}
-		offset.x += m_region_scale.x;
+		offset.x += scale.x;
 		offset.y = 0.f;
 	}
 
-	// insert cell references in spatial map
+	// the overlap tests run in parallel, the cells are added to the regions in order afterwards
+	std::vector<std::vector<uint32_t>> cell_regions(cells.size());
+	#pragma omp parallel for schedule(dynamic, 256)
+	for (int i = 0; i < cells.size(); i++) {
+		find_cell_regions(&cells[i], areas, scale, cell_regions[i]);
+	}
+
+	std::vector<std::vector<uint32_t>> regions(areas.size());
+	for (const auto &cell : cells) {
+		for (uint32_t region : cell_regions[cell.index]) {
+			regions[region].push_back(cell.index);
+		}
+	}
+
+	std::vector<uint32_t> region_offsets(regions.size() + 1);
+	region_offsets[0] = 0;
+	for (size_t i = 0; i < regions.size(); i++) {
+		region_offsets[i+1] = region_offsets[i] + regions[i].size();
+	}
+	std::vector<uint32_t> region_items;
+	region_items.reserve(region_offsets.back());
+	for (const auto &region : regions) {
+		region_items.insert(region_items.end(), region.begin(), region.end());
+	}
+
+	std::vector<glm::vec2> centers(cells.size());
 	for (const auto &cell : cells) {
-		add_cell_to_regions(&cell);
+		centers[cell.index] = cell.center;
+	}
+	std::vector<glm::vec2> positions(vertices.size());
+	for (const auto &vertex : vertices) {
+		positions[vertex.index] = vertex.position;
 	}
+	std::vector<uint32_t> edge_cells(2 * edges.size());
+	std::vector<uint32_t> edge_vertices(2 * edges.size());
+	for (const auto &edge : edges) {
+		edge_cells[2*edge.index] = edge.left_cell->index;
+		edge_cells[2*edge.index+1] = edge.right_cell->index;
+		edge_vertices[2*edge.index] = edge.left_vertex->index;
+		edge_vertices[2*edge.index+1] = edge.right_vertex->index;
+	}
+
+	FlatLayoutWriter writer(m_flat);
+	writer.write(FLAT_CELL_CENTERS, centers);
+	writer.write(FLAT_VERTEX_POSITIONS, positions);
+	writer.write_adjacency(FLAT_CELL_NEIGHBOR_OFFSETS, FLAT_CELL_NEIGHBOR_ITEMS, cells, &VoronoiCell::neighbors);
+	writer.write_adjacency(FLAT_CELL_VERTEX_OFFSETS, FLAT_CELL_VERTEX_ITEMS, cells, &VoronoiCell::vertices);
+	writer.write_adjacency(FLAT_CELL_EDGE_OFFSETS, FLAT_CELL_EDGE_ITEMS, cells, &VoronoiCell::edges);
+	writer.write_adjacency(FLAT_VERTEX_ADJACENT_OFFSETS, FLAT_VERTEX_ADJACENT_ITEMS, vertices, &VoronoiVertex::adjacent);
+	writer.write_adjacency(FLAT_VERTEX_CELL_OFFSETS, FLAT_VERTEX_CELL_ITEMS, vertices, &VoronoiVertex::cells);
+	writer.write(FLAT_EDGE_CELLS, edge_cells);
+	writer.write(FLAT_EDGE_VERTICES, edge_vertices);
+	writer.write(FLAT_REGION_OFFSETS, region_offsets);
+	writer.write(FLAT_REGION_ITEMS, region_items);
+
+	auto &header = writer.header();
+	header.magic = FLAT_VORONOI_MAGIC;
+	header.version = FLAT_VORONOI_VERSION;
+	header.size = m_flat.size();
+	header.bounds = bounds;
+	header.region_scale = scale;
+	header.region_resolution = CELL_REGION_RES;
+	header.cell_count = cells.size();
+	header.vertex_count = vertices.size();
+	header.edge_count = edges.size();
+
+	m_topology.map(m_flat.data(), m_flat.size());
 }
 	
-void VoronoiGraph::add_cell_to_regions(const VoronoiCell *cell)
+// nodes are created in the same order as they are in the flat layout
+void VoronoiGraph::create_nodes()
+{
+	const auto &topology = m_topology;
+
+	cells.resize(topology.cell_centers.size());
+	vertices.resize(topology.vertex_positions.size());
+	edges.resize(topology.edge_cells.size() / 2);
+
+	for (uint32_t i = 0; i < cells.size(); i++) {
+		auto &cell = cells[i];
+		cell.index = i;
+		cell.center = topology.cell_centers[i];
+		cell.neighbors.reserve(topology.cell_neighbors[i].size());
+		for (uint32_t neighbor : topology.cell_neighbors[i]) {
+			cell.neighbors.push_back(&cells[neighbor]);
+		}
+		cell.vertices.reserve(topology.cell_vertices[i].size());
+		for (uint32_t vertex : topology.cell_vertices[i]) {
+			cell.vertices.push_back(&vertices[vertex]);
+		}
+		cell.edges.reserve(topology.cell_edges[i].size());
+		for (uint32_t edge : topology.cell_edges[i]) {
+			cell.edges.push_back(&edges[edge]);
+		}
+	}
+
+	for (uint32_t i = 0; i < vertices.size(); i++) {
+		auto &vertex = vertices[i];
+		vertex.index = i;
+		vertex.position = topology.vertex_positions[i];
+		vertex.adjacent.reserve(topology.vertex_adjacent[i].size());
+		for (uint32_t adjacent : topology.vertex_adjacent[i]) {
+			vertex.adjacent.push_back(&vertices[adjacent]);
+		}
+		vertex.cells.reserve(topology.vertex_cells[i].size());
+		for (uint32_t cell : topology.vertex_cells[i]) {
+			vertex.cells.push_back(&cells[cell]);
+		}
+	}
+
+	for (uint32_t i = 0; i < edges.size(); i++) {
+		auto &edge = edges[i];
+		edge.index = i;
+		edge.left_cell = &cells[topology.edge_cells[2*i]];
+		edge.right_cell = &cells[topology.edge_cells[2*i+1]];
+		edge.left_vertex = &vertices[topology.edge_vertices[2*i]];
+		edge.right_vertex = &vertices[topology.edge_vertices[2*i+1]];
+	}
+}
+	
+void VoronoiGraph::find_cell_regions(const VoronoiCell *cell, const std::vector<Rectangle> &areas, const glm::vec2 &scale, std::vector<uint32_t> &regions) const
 {
 	// compute polygon bounding
 	Rectangle poly_bounds = {
@@ -206,16 +505,16 @@ void VoronoiGraph::add_cell_to_regions(const VoronoiCell *cell)
 	}
 
 	// bounds in grid
-	int min_x = floor(poly_bounds.min.x / m_region_scale.x);
-	int min_y = floor(poly_bounds.min.y / m_region_scale.y);
-	int max_x = floor(poly_bounds.max.x / m_region_scale.x);
-	int max_y = floor(poly_bounds.max.y / m_region_scale.y);
+	int min_x = floor(poly_bounds.min.x / scale.x);
+	int min_y = floor(poly_bounds.min.y / scale.y);
+	int max_x = floor(poly_bounds.max.x / scale.x);
+	int max_y = floor(poly_bounds.max.y / scale.y);
 
 	// polygon bounds are in a single grid region
 	if (min_x == max_x && min_y == max_y) {
 		int index = max_x + max_y * CELL_REGION_RES;
-		if (index > 0 && index < m_spatial_map.size()) {
-			m_spatial_map[index].cells.push_back(cell);
+		if (index > 0 && index < areas.size()) {
+			regions.push_back(index);
 			return;
 		}
 	}
@@ -224,16 +523,16 @@ void VoronoiGraph::add_cell_to_regions(const VoronoiCell *cell)
 	for (int py = min_y; py <= max_y; py++) {
 		for (int px = min_x; px <= max_x; px++) {
 			int index = px + py * CELL_REGION_RES;
-			if (index >= 0 && index < m_spatial_map.size()) {
-				if (cell_overlaps_rectangle(cell, m_spatial_map[index].bounds)) {
-					m_spatial_map[index].cells.push_back(cell);
+			if (index >= 0 && index < areas.size()) {
+				if (cell_overlaps_rectangle(cell, areas[index])) {
+					regions.push_back(index);
 				}
 			}
 		}
 	}
 }
 	
-bool VoronoiGraph::cell_overlaps_rectangle(const VoronoiCell *cell, const Rectangle &rectangle)
+bool VoronoiGraph::cell_overlaps_rectangle(const VoronoiCell *cell, const Rectangle &rectangle) const
 {
 	// cell center is in rectangle
 	// early exit
@@ -265,9 +564,50 @@ bool VoronoiGraph::cell_overlaps_rectangle(const VoronoiCell *cell, const Rectan
 	return false;
 }
 
+static void generate_diagram(const std::vector<jcv_point> &points, const jcv_rect &rect, uint8_t relaxations, std::vector<VoronoiCell> &cells, std::vector<VoronoiVertex> &vertices, std::vector<VoronoiEdge> &edges)
+{
+	// generate the diagram
+	jcv_diagram diagram;
+	memset(&diagram, 0, sizeof(jcv_diagram));
+	jcv_diagram_generate(points.size(), points.data(), &rect, 0, &diagram);
+
+	// relax the diagram if requested
+	for (uint8_t i = 0; i < relaxations; i++) {
+		std::vector<jcv_point> relaxed_points;
+		relax_points(&diagram, relaxed_points);
+		jcv_diagram_generate(relaxed_points.size(), relaxed_points.data(), &rect, 0, &diagram);
+	}
+
+	// vertex data
+	jcv_diagram_generate_vertices(&diagram);
+
+	// cells and vertices are independent
+	// after that duality and edges only touch different members of the nodes
+	#pragma omp parallel sections
+	{
+		#pragma omp section
+		adapt_cells(&diagram, cells);
+		#pragma omp section
+		adapt_vertices(&diagram, vertices);
+	}
+
+	#pragma omp parallel sections
+	{
+		#pragma omp section
+		pair_duality(&diagram, cells, vertices);
+		#pragma omp section
+		adapt_edges(&diagram, cells, vertices, edges);
+	}
+
+	jcv_diagram_free(&diagram);
+}
+
 static void relax_points(const jcv_diagram *diagram, std::vector<jcv_point> &points)
 {
+	points.resize(diagram->numsites);
+
 	const jcv_site* sites = jcv_diagram_get_sites(diagram);
+	#pragma omp parallel for schedule(static)
 	for( int i = 0; i < diagram->numsites; ++i ) {
 		const jcv_site* site = &sites[i];
 		jcv_point sum = site->p;
@@ -285,8 +625,374 @@ static void relax_points(const jcv_diagram *diagram, std::vector<jcv_point> &poi
 		jcv_point point;
 		point.x = sum.x / float(count);
 		point.y = sum.y / float(count);
-		points.push_back(point);
+		points[i] = point;
+	}
+}
+
+// one side of a cell polygon, sides are in the order jcv gives them
+struct CellSide {
+	int32_t neighbor; // site on the other side, negative if the side is on the border of the diagram
+	jcv_point start;
+};
+
+// polygons of all cells in the order of the input points, compressed sparse row
+struct CellPolygons {
+	std::vector<uint32_t> offsets;
+	std::vector<CellSide> sides;
+};
+
+// sides on the border get a negative code for each side of the bounds so they are never mistaken for sites
+static inline int32_t border_code(const jcv_graphedge *edge, const jcv_rect &rect)
+{
+	if (edge->pos[0].x == rect.min.x && edge->pos[1].x == rect.min.x) {
+		return -1;
 	}
+	if (edge->pos[0].x == rect.max.x && edge->pos[1].x == rect.max.x) {
+		return -2;
+	}
+	if (edge->pos[0].y == rect.min.y && edge->pos[1].y == rect.min.y) {
+		return -3;
+	}
+
+	return -4;
+}
+
+// builds the cells of the sites from first to last in x order with only the sites in a margin around them
+// a cell is kept if the circle through the site and each of its vertices lies within the margin, then no site outside the margin can change it
+// otherwise the margin is doubled until every cell is kept
+static void strip_polygons(const std::vector<jcv_point> &points, const std::vector<uint32_t> &order, const std::vector<double> &order_x, size_t first, size_t last, const jcv_rect &rect, double margin, std::vector<uint32_t> &sites, std::vector<uint32_t> &counts, std::vector<CellSide> &sides)
+{
+	const double core_min = order_x[first];
+	const double core_max = order_x[last-1];
+
+	jcv_diagram diagram;
+	memset(&diagram, 0, sizeof(jcv_diagram));
+
+	std::vector<jcv_point> local;
+
+	bool valid = false;
+	while (!valid) {
+		const bool left_border = core_min - margin <= rect.min.x;
+		const bool right_border = core_max + margin >= rect.max.x;
+		const jcv_rect local_rect = {
+			{ left_border ? rect.min.x : core_min - margin, rect.min.y },
+			{ right_border ? rect.max.x : core_max + margin, rect.max.y }
+		};
+
+		const size_t begin = left_border ? 0 : std::lower_bound(order_x.begin(), order_x.end(), local_rect.min.x) - order_x.begin();
+		const size_t end = right_border ? order_x.size() : std::upper_bound(order_x.begin(), order_x.end(), local_rect.max.x) - order_x.begin();
+
+		local.resize(end - begin);
+		for (size_t i = begin; i < end; i++) {
+			local[i-begin] = points[order[i]];
+		}
+
+		jcv_diagram_generate(local.size(), local.data(), &local_rect, 0, &diagram);
+
+		sites.clear();
+		counts.clear();
+		sides.clear();
+
+		valid = true;
+
+		const jcv_site *local_sites = jcv_diagram_get_sites(&diagram);
+		for (int i = 0; i < diagram.numsites && valid; i++) {
+			const jcv_site *site = &local_sites[i];
+			const size_t position = begin + site->index;
+			if (position < first || position >= last) {
+				continue;
+			}
+			uint32_t count = 0;
+			for (const jcv_graphedge *edge = site->edges; edge; edge = edge->next) {
+				const jcv_point &vertex = edge->pos[0];
+				const double radius = sqrt((vertex.x - site->p.x) * (vertex.x - site->p.x) + (vertex.y - site->p.y) * (vertex.y - site->p.y));
+				if ((!left_border && vertex.x - radius <= local_rect.min.x) || (!right_border && vertex.x + radius >= local_rect.max.x)) {
+					valid = false;
+					break;
+				}
+				int32_t neighbor = edge->neighbor ? order[begin + edge->neighbor->index] : border_code(edge, rect);
+				sides.push_back({ neighbor, vertex });
+				count++;
+			}
+			sites.push_back(order[position]);
+			counts.push_back(count);
+		}
+
+		margin *= 2.0;
+	}
+
+	jcv_diagram_free(&diagram);
+}
+
+// splits the sites in strips along the x axis that are built independently and then stitched together
+static void diagram_strips(const std::vector<jcv_point> &points, const jcv_rect &rect, CellPolygons &polygons)
+{
+	const size_t count = points.size();
+
+	std::vector<uint32_t> order(count);
+	for (uint32_t i = 0; i < count; i++) {
+		order[i] = i;
+	}
+	std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+		return points[a].x < points[b].x || (points[a].x == points[b].x && a < b);
+	});
+	std::vector<double> order_x(count);
+	for (size_t i = 0; i < count; i++) {
+		order_x[i] = points[order[i]].x;
+	}
+
+	// start with a margin of a few times the average distance between sites
+	const double area = (rect.max.x - rect.min.x) * (rect.max.y - rect.min.y);
+	const double margin = 4.0 * sqrt(area / count);
+
+	struct Strip {
+		std::vector<uint32_t> sites;
+		std::vector<uint32_t> counts;
+		std::vector<CellSide> sides;
+	};
+
+	// strips only depend on the site count so the result is the same for any number of threads
+	const int strip_count = (count + STRIP_SITE_COUNT - 1) / STRIP_SITE_COUNT;
+	std::vector<Strip> strips(strip_count);
+
+	#pragma omp parallel for schedule(dynamic)
+	for (int i = 0; i < strip_count; i++) {
+		const size_t first = i * count / strip_count;
+		const size_t last = (i + 1) * count / strip_count;
+		auto &strip = strips[i];
+		strip_polygons(points, order, order_x, first, last, rect, margin, strip.sites, strip.counts, strip.sides);
+	}
+
+	// stitch
+	polygons.offsets.assign(count + 1, 0);
+	for (const auto &strip : strips) {
+		for (size_t i = 0; i < strip.sites.size(); i++) {
+			polygons.offsets[strip.sites[i]+1] = strip.counts[i];
+		}
+	}
+	for (size_t i = 0; i < count; i++) {
+		polygons.offsets[i+1] += polygons.offsets[i];
+	}
+
+	polygons.sides.resize(polygons.offsets.back());
+
+	#pragma omp parallel for schedule(dynamic)
+	for (int i = 0; i < strip_count; i++) {
+		const auto &strip = strips[i];
+		const CellSide *side = strip.sides.data();
+		for (size_t j = 0; j < strip.sites.size(); j++) {
+			std::copy(side, side + strip.counts[j], polygons.sides.begin() + polygons.offsets[strip.sites[j]]);
+			side += strip.counts[j];
+		}
+	}
+}
+
+static void relax_polygons(const CellPolygons &polygons, std::vector<jcv_point> &points)
+{
+	#pragma omp parallel for schedule(static)
+	for (int i = 0; i < points.size(); i++) {
+		jcv_point sum = points[i];
+		int count = 1;
+		for (uint32_t j = polygons.offsets[i]; j < polygons.offsets[i+1]; j++) {
+			sum.x += polygons.sides[j].start.x;
+			sum.y += polygons.sides[j].start.y;
+			++count;
+		}
+
+		points[i].x = sum.x / float(count);
+		points[i].y = sum.y / float(count);
+	}
+}
+
+// creates the nodes from the cell polygons
+// the vertex at the end of side j of a polygon is identified by the site and the two neighbors of side j and j+1
+// every vertex and edge is numbered by the lowest site touching it, the other sites look it up in the polygon of that site
+static void adapt_polygons(const std::vector<jcv_point> &points, const CellPolygons &polygons, std::vector<VoronoiCell> &cells, std::vector<VoronoiVertex> &vertices, std::vector<VoronoiEdge> &edges)
+{
+	static const uint32_t NOT_FOUND = 0xffffffff;
+
+	const int count = points.size();
+	const auto &offsets = polygons.offsets;
+	const auto &sides = polygons.sides;
+
+	auto next_side = [&](uint32_t cell, uint32_t side) -> uint32_t {
+		return side + 1 < offsets[cell+1] ? side + 1 : offsets[cell];
+	};
+	auto previous_side = [&](uint32_t cell, uint32_t side) -> uint32_t {
+		return side > offsets[cell] ? side - 1 : offsets[cell+1] - 1;
+	};
+	auto vertex_owner = [&](uint32_t cell, uint32_t side) -> uint32_t {
+		int32_t a = sides[side].neighbor;
+		int32_t b = sides[next_side(cell, side)].neighbor;
+		uint32_t owner = cell;
+		if (a >= 0) { owner = std::min(owner, uint32_t(a)); }
+		if (b >= 0) { owner = std::min(owner, uint32_t(b)); }
+		return owner;
+	};
+	auto edge_owner = [&](uint32_t cell, uint32_t side) -> uint32_t {
+		int32_t neighbor = sides[side].neighbor;
+		return neighbor >= 0 ? std::min(cell, uint32_t(neighbor)) : cell;
+	};
+	auto find_corner = [&](uint32_t cell, int32_t a, int32_t b) -> uint32_t {
+		for (uint32_t side = offsets[cell]; side < offsets[cell+1]; side++) {
+			int32_t first = sides[side].neighbor;
+			int32_t second = sides[next_side(cell, side)].neighbor;
+			if ((first == a && second == b) || (first == b && second == a)) {
+				return side;
+			}
+		}
+		return NOT_FOUND;
+	};
+	auto find_side = [&](uint32_t cell, int32_t neighbor) -> uint32_t {
+		for (uint32_t side = offsets[cell]; side < offsets[cell+1]; side++) {
+			if (sides[side].neighbor == neighbor) {
+				return side;
+			}
+		}
+		return NOT_FOUND;
+	};
+
+	// number the owned vertices and edges
+	std::vector<uint32_t> vertex_offsets(count + 1, 0);
+	std::vector<uint32_t> edge_offsets(count + 1, 0);
+	#pragma omp parallel for schedule(static)
+	for (int cell = 0; cell < count; cell++) {
+		for (uint32_t side = offsets[cell]; side < offsets[cell+1]; side++) {
+			vertex_offsets[cell+1] += vertex_owner(cell, side) == cell;
+			edge_offsets[cell+1] += edge_owner(cell, side) == cell;
+		}
+	}
+	for (int cell = 0; cell < count; cell++) {
+		vertex_offsets[cell+1] += vertex_offsets[cell];
+		edge_offsets[cell+1] += edge_offsets[cell];
+	}
+
+	// vertex at the end of each side and edge of each side
+	std::vector<uint32_t> corner_vertices(sides.size(), NOT_FOUND);
+	std::vector<uint32_t> side_edges(sides.size(), NOT_FOUND);
+	#pragma omp parallel for schedule(static)
+	for (int cell = 0; cell < count; cell++) {
+		uint32_t vertex = vertex_offsets[cell];
+		uint32_t edge = edge_offsets[cell];
+		for (uint32_t side = offsets[cell]; side < offsets[cell+1]; side++) {
+			if (vertex_owner(cell, side) == cell) {
+				corner_vertices[side] = vertex++;
+			}
+			if (edge_owner(cell, side) == cell) {
+				side_edges[side] = edge++;
+			}
+		}
+	}
+	#pragma omp parallel for schedule(static)
+	for (int cell = 0; cell < count; cell++) {
+		for (uint32_t side = offsets[cell]; side < offsets[cell+1]; side++) {
+			uint32_t owner = vertex_owner(cell, side);
+			if (owner != cell) {
+				int32_t a = sides[side].neighbor;
+				int32_t b = sides[next_side(cell, side)].neighbor;
+				int32_t other = a == owner ? b : a;
+				uint32_t corner = find_corner(owner, cell, other);
+				if (corner != NOT_FOUND) {
+					corner_vertices[side] = corner_vertices[corner];
+				}
+			}
+			owner = edge_owner(cell, side);
+			if (owner != cell) {
+				uint32_t match = find_side(owner, cell);
+				if (match != NOT_FOUND) {
+					side_edges[side] = side_edges[match];
+				}
+			}
+		}
+	}
+
+	// cells with four or more sites on a circle can disagree on their vertices
+	// the vertices and edges that could not be matched are added separately
+	uint32_t vertex_count = vertex_offsets.back();
+	uint32_t edge_count = edge_offsets.back();
+	std::vector<uint8_t> created_vertex(sides.size(), 0);
+	std::vector<uint8_t> created_edge(sides.size(), 0);
+	for (int cell = 0; cell < count; cell++) {
+		for (uint32_t side = offsets[cell]; side < offsets[cell+1]; side++) {
+			if (corner_vertices[side] == NOT_FOUND) {
+				corner_vertices[side] = vertex_count++;
+				created_vertex[side] = 1;
+			} else {
+				created_vertex[side] = vertex_owner(cell, side) == cell;
+			}
+			if (side_edges[side] == NOT_FOUND) {
+				side_edges[side] = edge_count++;
+				created_edge[side] = 1;
+			} else {
+				created_edge[side] = edge_owner(cell, side) == cell;
+			}
+		}
+	}
+
+	cells.resize(count);
+	vertices.resize(vertex_count);
+	edges.resize(edge_count);
+
+	#pragma omp parallel for schedule(static)
+	for (int index = 0; index < count; index++) {
+		auto &cell = cells[index];
+		cell.index = index;
+		cell.center = glm::vec2(points[index].x, points[index].y);
+		for (uint32_t side = offsets[index]; side < offsets[index+1]; side++) {
+			const int32_t neighbor = sides[side].neighbor;
+			if (neighbor >= 0) {
+				cell.neighbors.push_back(&cells[neighbor]);
+			}
+			cell.edges.push_back(&edges[side_edges[side]]);
+			if (created_vertex[side]) {
+				const uint32_t next = next_side(index, side);
+				auto &vertex = vertices[corner_vertices[side]];
+				vertex.index = corner_vertices[side];
+				vertex.position = glm::vec2(sides[next].start.x, sides[next].start.y);
+				std::array<int32_t, 3> touching = { index, neighbor, sides[next].neighbor };
+				std::sort(touching.begin(), touching.end());
+				for (int32_t site : touching) {
+					if (site >= 0) {
+						vertex.cells.push_back(&cells[site]);
+					}
+				}
+			}
+			if (created_edge[side]) {
+				auto &edge = edges[side_edges[side]];
+				edge.index = side_edges[side];
+				edge.left_cell = &cells[index];
+				edge.right_cell = neighbor >= 0 ? &cells[neighbor] : &cells[index];
+				edge.left_vertex = &vertices[corner_vertices[previous_side(index, side)]];
+				edge.right_vertex = &vertices[corner_vertices[side]];
+			}
+		}
+		// same as the other diagram, every vertex once in ascending order
+		for (uint32_t side = offsets[index]; side < offsets[index+1]; side++) {
+			cell.vertices.push_back(&vertices[corner_vertices[side]]);
+		}
+		std::sort(cell.vertices.begin(), cell.vertices.end());
+		cell.vertices.erase(std::unique(cell.vertices.begin(), cell.vertices.end()), cell.vertices.end());
+	}
+
+	for (const auto &edge : edges) {
+		vertices[edge.left_vertex->index].adjacent.push_back(edge.right_vertex);
+		vertices[edge.right_vertex->index].adjacent.push_back(edge.left_vertex);
+	}
+}
+
+static void generate_strips(const std::vector<jcv_point> &points, const jcv_rect &rect, uint8_t relaxations, std::vector<VoronoiCell> &cells, std::vector<VoronoiVertex> &vertices, std::vector<VoronoiEdge> &edges)
+{
+	std::vector<jcv_point> sites = points;
+
+	CellPolygons polygons;
+	diagram_strips(sites, rect, polygons);
+
+	for (uint8_t i = 0; i < relaxations; i++) {
+		relax_polygons(polygons, sites);
+		diagram_strips(sites, rect, polygons);
+	}
+
+	adapt_polygons(sites, polygons, cells, vertices, edges);
 }
 
 static void adapt_cells(const jcv_diagram *diagram, std::vector<VoronoiCell> &cells)
@@ -345,19 +1051,21 @@ static void pair_duality(const jcv_diagram *diagram, std::vector<VoronoiCell> &c
 	const jcv_site *sites = jcv_diagram_get_sites(diagram);
 
 	// get vertex and cell duality
+	std::vector<uint32_t> indices;
 	for (int i = 0; i < diagram->numsites; i++) {
 		const jcv_site *site = &sites[i];
 		const jcv_graphedge *edge = site->edges;
-		std::set<uint32_t> indices;
+		indices.clear();
 		while (edge) {
 			const jcv_altered_edge *altered = get_altered_edge(edge);
-			jcv_vertex *a = altered->vertices[0];
-			indices.insert(a->index);
-			jcv_vertex *b = altered->vertices[1];
-			indices.insert(b->index);
+			indices.push_back(altered->vertices[0]->index);
+			indices.push_back(altered->vertices[1]->index);
 
 			edge = edge->next;
 		}
+		// every vertex once in ascending order
+		std::sort(indices.begin(), indices.end());
+		indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
 		for (auto index : indices) {
 			cells[site->index].vertices.push_back(&vertices[index]);
 		}
@@ -1,5 +1,6 @@
 #pragma once
-#include <map>
+#include <span>
+#include <vector>
 
 namespace geom {
 
@@ -30,31 +31,100 @@ struct VoronoiCell {
 	std::vector<const VoronoiEdge*> edges;
 };
 
-template <class Archive>
-void serialize(Archive &archive, VoronoiEdge &edge)
-{
-	archive(edge.index);
-}
-
-template <class Archive>
-void serialize(Archive &archive, VoronoiVertex &vertex)
-{
-	archive(vertex.index, vertex.position);
-}
-
-template <class Archive>
-void serialize(Archive &archive, VoronoiCell &cell)
-{
-	archive(cell.index, cell.center);
-}
-
-// contains voronoi cells overlapping an area defined by bounds
-// for spatial searching
-struct VoronoiCellsRegion {
-	Rectangle bounds = {};
-	std::vector<const VoronoiCell*> cells;
+// compressed sparse row adjacency
+// the items of node i are stored in items[offsets[i]] up to items[offsets[i+1]]
+struct AdjacencyList {
+	std::span<const uint32_t> offsets;
+	std::span<const uint32_t> items;
+
+	size_t size() const { return offsets.empty() ? 0 : offsets.size() - 1; }
+	std::span<const uint32_t> operator[](uint32_t node) const
+	{
+		return items.subspan(offsets[node], offsets[node+1] - offsets[node]);
+	}
+};
+
+// arrays in the flat binary layout of the graph
+enum FlatVoronoiArray : uint32_t {
+	FLAT_CELL_CENTERS,
+	FLAT_VERTEX_POSITIONS,
+	FLAT_CELL_NEIGHBOR_OFFSETS,
+	FLAT_CELL_NEIGHBOR_ITEMS,
+	FLAT_CELL_VERTEX_OFFSETS,
+	FLAT_CELL_VERTEX_ITEMS,
+	FLAT_CELL_EDGE_OFFSETS,
+	FLAT_CELL_EDGE_ITEMS,
+	FLAT_VERTEX_ADJACENT_OFFSETS,
+	FLAT_VERTEX_ADJACENT_ITEMS,
+	FLAT_VERTEX_CELL_OFFSETS,
+	FLAT_VERTEX_CELL_ITEMS,
+	FLAT_EDGE_CELLS,
+	FLAT_EDGE_VERTICES,
+	FLAT_REGION_OFFSETS,
+	FLAT_REGION_ITEMS,
+	FLAT_ARRAY_COUNT
+};
+
+struct FlatVoronoiSection {
+	uint64_t offset = 0; // in bytes from the start of the layout
+	uint64_t count = 0; // number of elements
+};
+
+// fixed size header at the start of the flat layout
+// every array after it starts on a 64 byte boundary
+// all references are indices so the layout can be used in place, for example from a memory mapped file
+// stored in native byte order
+struct FlatVoronoiHeader {
+	uint32_t magic = 0;
+	uint32_t version = 0;
+	uint64_t size = 0; // of the whole layout in bytes
+	Bounding<glm::vec2> bounds = {};
+	glm::vec2 region_scale = {}; // size of a cell region for spatial searching
+	uint32_t region_resolution = 0; // cell regions along each axis
+	uint32_t cell_count = 0;
+	uint32_t vertex_count = 0;
+	uint32_t edge_count = 0;
+	FlatVoronoiSection sections[FLAT_ARRAY_COUNT];
 };
 
+// structure of arrays form of the graph with indices instead of pointers
+// a view on the flat binary layout, it does not own any memory
+// the order of each list is the same as in the node vectors
+struct VoronoiTopology {
+	Bounding<glm::vec2> bounds = {};
+	std::span<const glm::vec2> cell_centers;
+	std::span<const glm::vec2> vertex_positions;
+	AdjacencyList cell_neighbors; // excludes the borders of the diagram
+	AdjacencyList cell_vertices;
+	AdjacencyList cell_edges; // includes the borders of the diagram
+	AdjacencyList vertex_adjacent;
+	AdjacencyList vertex_cells;
+	// two entries for each edge, left at 2*i and right at 2*i+1
+	// both cells are the same if the edge is at the border of the diagram
+	std::span<const uint32_t> edge_cells;
+	std::span<const uint32_t> edge_vertices;
+	// cells overlapping each region of a uniform grid, for spatial searching
+	AdjacencyList region_cells;
+	glm::vec2 region_scale = {};
+	uint32_t region_resolution = 0;
+
+	// the cell on the other side of an edge
+	uint32_t opposite_cell(uint32_t edge, uint32_t cell) const
+	{
+		return edge_cells[2*edge] == cell ? edge_cells[2*edge+1] : edge_cells[2*edge];
+	}
+	// the edge between two vertices, false if they are not adjacent
+	bool edge_between(uint32_t a, uint32_t b, uint32_t &edge) const;
+	// closest cell to a position, false if the position is outside the graph
+	bool cell_at(const glm::vec2 &position, uint32_t &cell) const;
+	// points the view to a flat layout, returns false if the layout is invalid
+	// the data has to stay alive as long as the view is used
+	bool map(const uint8_t *data, size_t size);
+};
+
+// cell index for positions outside the graph
+static const uint32_t VORONOI_NO_CELL = 0xffffffff;
+
 // search result of spatial searching
 struct VoronoiSearchResult {
 	bool found = false;
@@ -70,56 +140,47 @@ public:
 	void generate(const std::vector<glm::vec2> &locations, const Bounding<glm::vec2> &bounds, uint8_t relaxations = 0);
 	void clear();
 public:
+	// optional raster of cell indices so most positions are found with a single lookup
+	// positions on pixels that overlap more than one cell fall back to the exact search
+	void build_cell_raster(uint32_t resolution);
 	VoronoiSearchResult cell_at(const glm::vec2 &position) const;
+	// finds the cells of many positions at once, VORONOI_NO_CELL for positions outside the graph
+	void cells_at(std::span<const glm::vec2> positions, std::span<uint32_t> indices) const;
+	const VoronoiTopology& topology() const { return m_topology; }
+	// the flat binary layout of the graph
+	const std::vector<uint8_t>& flat_layout() const { return m_flat; }
+	// takes over a flat layout and creates the nodes from it
+	// returns false and leaves the graph empty if the layout is invalid
+	bool load_flat_layout(std::vector<uint8_t> &&layout);
 public:
 	template <class Archive>
 	void save(Archive &archive) const
 	{
-		archive(
-			m_bounds.min, m_bounds.max,
-			cells, vertices, edges,
-			m_connected_cells,
-			m_connected_vertices,
-			m_cell_vertex_connections
-		);
+		archive(m_flat);
 	}
 	template <class Archive>
 	void load(Archive &archive)
 	{
-		// clear data just to be sure
-		clear();
-
-		archive(
-			m_bounds.min, m_bounds.max,
-			cells, vertices, edges,
-			m_connected_cells,
-			m_connected_vertices,
-			m_cell_vertex_connections
-		);
+		std::vector<uint8_t> layout;
+		archive(layout);
 
-		unserialize_nodes();
-
-		create_spatial_map();
+		// same as any other corrupt archive
+		if (!load_flat_layout(std::move(layout))) {
+			throw cereal::Exception("invalid voronoi graph layout");
+		}
 	}
 private:
-	Bounding<glm::vec2> m_bounds = {};
-	glm::vec2 m_region_scale = {};
-	std::vector<VoronoiCellsRegion> m_spatial_map;
-private:
-	// left: edge index
-	// right: connected cells 
-	std::map<uint32_t, std::pair<uint32_t, uint32_t>> m_connected_cells;
-	// left: edge index
-	// right: connected vertices 
-	std::map<uint32_t, std::pair<uint32_t, uint32_t>> m_connected_vertices;
-	// left: cell index
-	// right: vertex index
-	std::vector<std::pair<uint32_t, uint32_t>> m_cell_vertex_connections;
+	std::vector<uint8_t> m_flat;
+	VoronoiTopology m_topology;
+	std::vector<uint32_t> m_cell_raster; // VORONOI_NO_CELL if the pixel is on a cell boundary
+	uint32_t m_raster_resolution = 0;
+	glm::vec2 m_raster_scale = {};
 private:
-	void unserialize_nodes();
-	void create_spatial_map();
-	void add_cell_to_regions(const VoronoiCell *cell);
-	bool cell_overlaps_rectangle(const VoronoiCell *cell, const Rectangle &rectangle);
+	uint32_t find_cell(const glm::vec2 &position) const;
+	void build_flat_layout(const Bounding<glm::vec2> &bounds);
+	void create_nodes();
+	void find_cell_regions(const VoronoiCell *cell, const std::vector<Rectangle> &areas, const glm::vec2 &scale, std::vector<uint32_t> &regions) const;
+	bool cell_overlaps_rectangle(const VoronoiCell *cell, const Rectangle &rectangle) const;
 };
 
 };
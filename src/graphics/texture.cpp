@@ -62,6 +62,9 @@ void Texture::create(const util::Image<uint8_t> &image)
 
 	glBindTexture(m_target, m_binding);
 
+	m_width = image.width();
+	m_height = image.height();
+
 	glTexStorage2D(m_target, 1, internal_format, image.width(), image.height());
 	glTexSubImage2D(m_target, 0, 0, 0, image.width(), image.height(), m_format, type, image.raster().data());
 
@@ -102,6 +105,9 @@ void Texture::create(const util::Image<float> &image)
 
 	glBindTexture(m_target, m_binding);
 
+	m_width = image.width();
+	m_height = image.height();
+
 	glTexStorage2D(m_target, 1, internal_format, image.width(), image.height());
 	glTexSubImage2D(m_target, 0, 0, 0, image.width(), image.height(), m_format, type, image.raster().data());
 
@@ -116,12 +122,28 @@ void Texture::create(const util::Image<float> &image)
 
 void Texture::reload(const util::Image<uint8_t> &image)
 {
+	// texture storage is immutable so a different size needs a new texture
+	if (image.width() != m_width || image.height() != m_height) {
+		glDeleteTextures(1, &m_binding);
+		glGenTextures(1, &m_binding);
+		create(image);
+		return;
+	}
+
 	glBindTexture(m_target, m_binding);
 	glTexSubImage2D(m_target, 0, 0, 0, image.width(), image.height(), m_format, GL_UNSIGNED_BYTE, image.raster().data());
 }
 
 void Texture::reload(const util::Image<float> &image)
 {
+	// texture storage is immutable so a different size needs a new texture
+	if (image.width() != m_width || image.height() != m_height) {
+		glDeleteTextures(1, &m_binding);
+		glGenTextures(1, &m_binding);
+		create(image);
+		return;
+	}
+
 	glBindTexture(m_target, m_binding);
 	glTexSubImage2D(m_target, 0, 0, 0, image.width(), image.height(), m_format, GL_FLOAT, image.raster().data());
 }
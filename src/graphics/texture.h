@@ -19,6 +19,8 @@ private:
 	GLuint m_binding = 0;
 	GLenum m_target = GL_TEXTURE_2D;
 	GLenum m_format = GL_RED;
+	int m_width = 0;
+	int m_height = 0;
 };
 
 };
@@ -0,0 +1,295 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <chrono>
+#include <list>
+#include <queue>
+#include <span>
+#include <charconv>
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+#include <glm/glm.hpp>
+#include <glm/vec3.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "../geometry/geometry.h"
+#include "../geometry/voronoi.h"
+#include "../util/image.h"
+
+#include "../campaign/atlas.h"
+
+// headless world generation benchmark
+// generates an atlas for every combination of seeds and tile counts
+// and prints the duration of each generation stage as CSV to stdout
+// the total of every generation also has the peak memory use of the process so far
+
+struct BenchOptions {
+	std::vector<int> seeds = { 1, 2, 3 };
+	std::vector<int> tile_counts = { 2000, 8000, 16000 };
+	int repeats = 1;
+	float map_size = 1024.f;
+	int resolution = 2048;
+	bool huge = false; // huge map parameters for every tile count, overrides the resolution
+	bool check = false; // validate the rivers of every world
+};
+
+// false if the whole text is not a number
+template <typename T>
+static bool parse_value(const std::string &text, T &value)
+{
+	const char *end = text.data() + text.size();
+	auto result = std::from_chars(text.data(), end, value);
+
+	return result.ec == std::errc() && result.ptr == end;
+}
+
+static bool parse_list(const std::string &text, std::vector<int> &values)
+{
+	values.clear();
+
+	std::stringstream stream(text);
+	std::string token;
+	while (std::getline(stream, token, ',')) {
+		int value = 0;
+		if (!token.empty()) {
+			if (!parse_value(token, value)) {
+				return false;
+			}
+			values.push_back(value);
+		}
+	}
+
+	return true;
+}
+
+static void print_usage(const char *program)
+{
+	std::cerr << "usage: " << program << " [-s seeds] [-t tile_counts] [-r repeats] [-m map_size] [-p resolution] [-H] [-c]\n";
+	std::cerr << "  seeds and tile counts are comma separated lists, e.g. -s 1,2,3 -t 8000,16000\n";
+	std::cerr << "  -H generates huge maps, e.g. -H -t 100000,250000,1000000\n";
+	std::cerr << "  -c checks the rivers of every world and fails if one is invalid\n";
+}
+
+static bool parse_options(int argc, char *argv[], BenchOptions &options)
+{
+	for (int i = 1; i < argc; i++) {
+		std::string flag = argv[i];
+		if (flag == "-H") {
+			options.huge = true;
+			continue;
+		} else if (flag == "-c") {
+			options.check = true;
+			continue;
+		}
+		if (i + 1 >= argc) {
+			return false;
+		}
+		std::string value = argv[++i];
+		bool valid = false;
+		if (flag == "-s") {
+			valid = parse_list(value, options.seeds);
+		} else if (flag == "-t") {
+			valid = parse_list(value, options.tile_counts);
+		} else if (flag == "-r") {
+			valid = parse_value(value, options.repeats);
+		} else if (flag == "-m") {
+			valid = parse_value(value, options.map_size);
+		} else if (flag == "-p") {
+			valid = parse_value(value, options.resolution);
+		}
+		if (!valid) {
+			return false;
+		}
+	}
+
+	return !options.seeds.empty() && !options.tile_counts.empty() && options.repeats > 0 && options.resolution > 0;
+}
+
+// FNV-1a hash of the generated data
+// used to detect if a change in the generator alters the output
+static uint64_t fingerprint(const Atlas &atlas)
+{
+	uint64_t hash = 14695981039346656037ULL;
+	auto feed = [&hash](const void *data, size_t size) {
+		const uint8_t *bytes = static_cast<const uint8_t*>(data);
+		for (size_t i = 0; i < size; i++) {
+			hash ^= bytes[i];
+			hash *= 1099511628211ULL;
+		}
+	};
+
+	for (const auto &tile : atlas.tiles()) {
+		feed(&tile.height, sizeof(tile.height));
+		feed(&tile.flags, sizeof(tile.flags));
+		feed(&tile.relief, sizeof(tile.relief));
+	}
+	for (const auto &corner : atlas.corners()) {
+		feed(&corner.flags, sizeof(corner.flags));
+	}
+	for (const auto &border : atlas.borders()) {
+		feed(&border.flags, sizeof(border.flags));
+	}
+	const auto &raster = atlas.heightmap().raster();
+	feed(raster.data(), raster.size() * sizeof(float));
+
+	return hash;
+}
+
+// peak resident memory of the process in megabytes, zero if unknown
+static double peak_megabytes()
+{
+#if defined(__APPLE__)
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_maxrss / (1024.0 * 1024.0); // in bytes
+#elif defined(__unix__)
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_maxrss / 1024.0; // in kilobytes
+#else
+	return 0.0;
+#endif
+}
+
+static uint32_t find_root(std::vector<uint32_t> &parents, uint32_t node)
+{
+	while (parents[node] != node) {
+		parents[node] = parents[parents[node]];
+		node = parents[node];
+	}
+
+	return node;
+}
+
+// checks that the rivers form valid drainage basins
+// every river corner is on land, every river border joins two river corners
+// and the river borders form trees that each flow into exactly one coast corner
+static bool check_rivers(const Atlas &atlas, std::string &error)
+{
+	const auto &topology = atlas.graph().topology();
+	const auto &tiles = atlas.tiles();
+	const auto &corners = atlas.corners();
+	const auto &borders = atlas.borders();
+
+	std::vector<uint32_t> parents(corners.size());
+	for (uint32_t i = 0; i < parents.size(); i++) {
+		parents[i] = i;
+	}
+	std::vector<bool> on_river(corners.size(), false);
+
+	for (const auto &border : borders) {
+		if (!(border.flags & BORDER_FLAG_RIVER)) {
+			continue;
+		}
+		const uint32_t a = topology.edge_vertices[2*border.index];
+		const uint32_t b = topology.edge_vertices[2*border.index+1];
+		if (!(corners[a].flags & CORNER_FLAG_RIVER) || !(corners[b].flags & CORNER_FLAG_RIVER)) {
+			error = "river border " + std::to_string(border.index) + " does not join two river corners";
+			return false;
+		}
+		const uint32_t root_a = find_root(parents, a);
+		const uint32_t root_b = find_root(parents, b);
+		if (root_a == root_b) {
+			error = "river border " + std::to_string(border.index) + " closes a loop";
+			return false;
+		}
+		parents[root_a] = root_b;
+		on_river[a] = true;
+		on_river[b] = true;
+	}
+
+	std::vector<uint32_t> mouths(corners.size(), 0);
+	for (const auto &corner : corners) {
+		if (!(corner.flags & CORNER_FLAG_RIVER)) {
+			continue;
+		}
+		if (!on_river[corner.index]) {
+			error = "river corner " + std::to_string(corner.index) + " has no river border";
+			return false;
+		}
+		bool land = false;
+		for (uint32_t cell : topology.vertex_cells[corner.index]) {
+			land = land || tiles[cell].relief != ReliefType::SEABED;
+		}
+		if (!land) {
+			error = "river corner " + std::to_string(corner.index) + " is in the sea";
+			return false;
+		}
+		if (corner.flags & CORNER_FLAG_COAST) {
+			mouths[find_root(parents, corner.index)]++;
+		}
+	}
+
+	for (const auto &corner : corners) {
+		if ((corner.flags & CORNER_FLAG_RIVER) && find_root(parents, corner.index) == corner.index && mouths[corner.index] != 1) {
+			error = "river through corner " + std::to_string(corner.index) + " has " + std::to_string(mouths[corner.index]) + " mouths";
+			return false;
+		}
+	}
+
+	for (const auto &tile : tiles) {
+		bool river = false;
+		for (uint32_t edge : topology.cell_edges[tile.index]) {
+			river = river || (borders[edge].flags & BORDER_FLAG_RIVER);
+		}
+		if (river != bool(tile.flags & TILE_FLAG_RIVER)) {
+			error = "tile " + std::to_string(tile.index) + " has the wrong river flag";
+			return false;
+		}
+	}
+
+	return true;
+}
+
+int main(int argc, char *argv[])
+{
+	BenchOptions options;
+	if (!parse_options(argc, argv, options)) {
+		print_usage(argv[0]);
+		return 1;
+	}
+
+	const geom::Rectangle bounds = { { 0.f, 0.f }, { options.map_size, options.map_size } };
+
+	Atlas atlas;
+
+	std::cout << "seed,tile_count,repeat,stage,milliseconds,fingerprint,peak_megabytes\n";
+
+	bool valid = true;
+
+	for (int tile_count : options.tile_counts) {
+		for (int seed : options.seeds) {
+			for (int repeat = 0; repeat < options.repeats; repeat++) {
+				AtlasParameters parameters = {};
+				if (options.huge) {
+					parameters = huge_map_parameters(tile_count);
+				} else {
+					parameters.tile_count = tile_count;
+					parameters.resolution = options.resolution;
+				}
+
+				auto start = std::chrono::steady_clock::now();
+				atlas.generate(seed, bounds, parameters);
+				auto end = std::chrono::steady_clock::now();
+				double total = std::chrono::duration<double, std::milli>(end - start).count();
+
+				uint64_t hash = fingerprint(atlas);
+
+				for (const auto &timing : atlas.stage_times()) {
+					std::cout << seed << ',' << tile_count << ',' << repeat << ',' << timing.stage << ',' << timing.milliseconds << ',' << hash << ",\n";
+				}
+				std::cout << seed << ',' << tile_count << ',' << repeat << ",total," << total << ',' << hash << ',' << peak_megabytes() << std::endl;
+
+				std::string error;
+				if (options.check && !check_rivers(atlas, error)) {
+					std::cerr << "seed " << seed << " with " << tile_count << " tiles has invalid rivers: " << error << '\n';
+					valid = false;
+				}
+			}
+		}
+	}
+
+	return valid ? 0 : 1;
+}
@@ -0,0 +1,156 @@
+#include <iostream>
+#include <string>
+#include <algorithm>
+#include <chrono>
+#include <unordered_map>
+#include <list>
+#include <memory>
+#include <queue>
+#include <random>
+#include <fstream>
+#include <charconv>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "../util/serialize.h"
+#include "../util/slotmap.h"
+#include "../util/camera.h"
+#include "../util/navigation.h"
+#include "../util/pathservice.h"
+#include "../util/animation.h"
+#include "../geometry/geometry.h"
+#include "../geometry/transform.h"
+#include "../geometry/voronoi.h"
+#include "../util/image.h"
+#include "../util/heightpyramid.h"
+#include "../physics/physical.h"
+#include "../physics/heightfield.h"
+#include "../physics/trigger.h"
+
+#include "../console.h"
+
+#include "../campaign/campaign.h"
+
+// headless campaign simulation
+// loads a saved campaign without a window or GL context and advances it a number of game ticks as fast as possible
+// built with CAMPAIGN_HEADLESS so the campaign code leaves out its rendering and input and nothing links against SDL or GL
+// the state of the world is printed every report interval as CSV to stdout so the AI can be soak tested
+
+struct SimOptions {
+	std::string save = {};
+	std::string output = {}; // the campaign is saved here afterwards, empty to discard it
+	uint64_t ticks = 12 * TICKS_PER_MONTH;
+	uint64_t report = TICKS_PER_MONTH;
+};
+
+static void print_usage(const char *program)
+{
+	std::cerr << "usage: " << program << " [-t ticks] [-r report_ticks] [-o output_save] save\n";
+	std::cerr << "  a game month is " << TICKS_PER_MONTH << " ticks, e.g. -t 60000 runs a thousand months\n";
+}
+
+// false if the whole text is not a tick count
+static bool parse_ticks(const std::string &text, uint64_t &ticks)
+{
+	const char *end = text.data() + text.size();
+	auto result = std::from_chars(text.data(), end, ticks);
+
+	return result.ec == std::errc() && result.ptr == end;
+}
+
+static bool parse_options(int argc, char *argv[], SimOptions &options)
+{
+	for (int i = 1; i < argc; i++) {
+		std::string flag = argv[i];
+		if (flag[0] != '-') {
+			options.save = flag;
+			continue;
+		}
+		if (i + 1 >= argc) {
+			return false;
+		}
+		std::string value = argv[++i];
+		if (flag == "-t") {
+			if (!parse_ticks(value, options.ticks)) {
+				return false;
+			}
+		} else if (flag == "-r") {
+			if (!parse_ticks(value, options.report)) {
+				return false;
+			}
+		} else if (flag == "-o") {
+			options.output = value;
+		} else {
+			return false;
+		}
+	}
+
+	return !options.save.empty() && options.report > 0;
+}
+
+static void print_report(const Campaign &campaign, double milliseconds, uint64_t ticks)
+{
+	int64_t gold = 0;
+	for (const auto &mapping : campaign.faction_controller.factions) {
+		gold += mapping.second->gold();
+	}
+
+	const double ticks_per_second = milliseconds > 0.0 ? ticks / (milliseconds / 1000.0) : 0.0;
+
+	std::cout << campaign.game_ticks << ',' << campaign.game_ticks / TICKS_PER_MONTH << ',' << milliseconds << ',' << ticks_per_second << ',';
+	std::cout << campaign.faction_controller.factions.size() << ',' << campaign.settlement_controller.towns.size() << ',';
+	std::cout << campaign.settlement_controller.fiefdoms.size() << ',' << campaign.meeple_controller.meeples.size() << ',' << gold << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+	SimOptions options;
+	if (!parse_options(argc, argv, options)) {
+		print_usage(argv[0]);
+		return 1;
+	}
+
+	if (!std::ifstream(options.save).is_open()) {
+		std::cerr << "could not open save file " << options.save << '\n';
+		return 1;
+	}
+
+	Campaign campaign;
+	campaign.init_headless();
+	campaign.load(options.save);
+	campaign.prepare();
+	campaign.state = CampaignState::RUNNING;
+
+	std::cout << "tick,month,milliseconds,ticks_per_second,factions,towns,fiefdoms,meeples,gold\n";
+
+	auto start = std::chrono::steady_clock::now();
+
+	uint64_t remaining = options.ticks;
+	while (remaining > 0) {
+		const uint64_t ticks = std::min(remaining, options.report);
+
+		auto batch_start = std::chrono::steady_clock::now();
+		campaign.simulate(ticks);
+		auto batch_end = std::chrono::steady_clock::now();
+
+		print_report(campaign, std::chrono::duration<double, std::milli>(batch_end - batch_start).count(), ticks);
+
+		// nobody reads the console here
+		Console::clear();
+
+		remaining -= ticks;
+	}
+
+	auto end = std::chrono::steady_clock::now();
+	double total = std::chrono::duration<double, std::milli>(end - start).count();
+	std::cerr << options.ticks << " ticks in " << total << " ms, " << (total > 0.0 ? options.ticks / (total / 1000.0) : 0.0) << " ticks per second\n";
+
+	if (!options.output.empty()) {
+		campaign.save(options.output);
+	}
+
+	campaign.clear();
+
+	return 0;
+}
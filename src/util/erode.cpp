@@ -2,366 +2,349 @@
 #include <vector>
 #include <string>
 #include <cmath>
+#include <algorithm>
 
 #include "image.h"
 #include "erode.h"
 
 namespace util {
 
-static const float l = 1.f; // pipe length
-			    //
-struct vec3 {
-	float x = 0.f;
-	float y = 0.f;
-	float z = 0.f;
-	float magnitude()
-	{
-		float sum = x * x + y * y + z * z;
-		return sqrtf(sum);
-	}
-	void normalize()
-	{
-		float len = magnitude();
-		if (len > 0.f) {
-			x /= len;
-			y /= len;
-			z /= len;
-		}
-	}
-};
-
-static inline float output_flow(float A, float g, float l, float h, float f, float time)
+static const float TIME_STEP = 0.1f;
+static const float RAIN = 0.01f; // fixed amount of rain
+static const float PIPE_LENGTH = 1.f;
+static const float PIPE_AREA = PIPE_LENGTH * PIPE_LENGTH;
+static const float GRAVITY = 0.8f;
+static const float DISSOLVING = 0.025f; // dissolving constant Ks
+static const float DEPOSITION = 0.025f; // deposition constant Kd
+static const float CAPACITY = 0.08f; // sediment transport capacity constant Kc
+static const float EVAPORATION = 0.4f; // evaporation constant Ke
+
+// sine for angles in [0, 1] radians, a plain polynomial so the kernels can be vectorized
+static inline float sine(float x)
 {
-	float s = A * ((g * h) / l);
+	const float x2 = x * x;
 
-	return std::max(0.f, f + time * s);
+	return x * (1.f - x2 * (1.f / 6.f - x2 * (1.f / 120.f - x2 * (1.f / 5040.f))));
 }
-	
-// find slope angle at location xy
-float Eroder::terrain_slope(int x, int y) const
+
+static inline float bilinear(const float *plane, int stride, float x, float y)
 {
-	float T = m_terrain_ping.sample(x, y + 1, CHANNEL_RED);
-	float B = m_terrain_ping.sample(x, y - 1, CHANNEL_RED);
-	float R = m_terrain_ping.sample(x + 1, y, CHANNEL_RED);
-	float L = m_terrain_ping.sample(x - 1, y, CHANNEL_RED);
+	// coordinates start at -1 so adding one before the cast floors them
+	const int x0 = int(x + 1.f) - 1;
+	const int y0 = int(y + 1.f) - 1;
+	const float fx = x - x0;
+	const float fy = y - y0;
 
-	vec3 normal = { L - R, 2.f, T - B };
-	normal.normalize();
+	const int i = (y0 + 1) * stride + (x0 + 1);
+	const float top = plane[i] + fx * (plane[i + 1] - plane[i]);
+	const float bottom = plane[i + stride] + fx * (plane[i + stride + 1] - plane[i + stride]);
 
-	return normal.y;
+	return top + fy * (bottom - top);
 }
-	
-void Eroder::erode(Image<float> &image)
+
+void Eroder::erode(Image<float> &image, int iterations, int resolution)
 {
-	m_width = image.width();
-	m_height = image.height();
-
-	m_terrain_ping.resize(image.width(), image.height(), 1);
-	m_terrain_pong.resize(image.width(), image.height(), 1);
-	m_water_ping.resize(image.width(), image.height(), 1);
-	m_water_pong.resize(image.width(), image.height(), 1);
-	m_flux_ping.resize(image.width(), image.height(), 4);
-	m_flux_pong.resize(image.width(), image.height(), 4);
-	m_velocity.resize(image.width(), image.height(), 2);
-	m_sediment_ping.resize(image.width(), image.height(), 1);
-	m_sediment_pong.resize(image.width(), image.height(), 1);
-
-	m_terrain_ping.copy(image);
-
-	float time = 0.1f;
-	for (int i = 0; i < 1000; i++) {
-		erosion_step(time);
+	if (iterations <= 0 || image.width() == 0 || image.height() == 0) {
+		return;
 	}
 
-	image.copy(m_terrain_ping);
-}
-	
-void Eroder::erosion_step(float time)
-{
-	const int n_steps = 32;
-	const int step_size = m_width / n_steps;
+	const int width = image.width();
+	const int height = image.height();
 
-	#pragma omp parallel for
-	for (int step_x = 0; step_x < m_width; step_x += step_size) {
-		int w = step_x + step_size;
-		int h = m_height;
-		for (int i = 0; i < h; i++) {
-			for (int j = step_x; j < w; j++) {
-				increment_water(i, j, time);
-			}
-		}
+	// simulation size
+	int sim_width = width;
+	int sim_height = height;
+	const int longest = std::max(width, height);
+	if (resolution > 0 && resolution < longest) {
+		sim_width = std::max(2, width * resolution / longest);
+		sim_height = std::max(2, height * resolution / longest);
 	}
-	std::swap(m_water_ping, m_water_pong);
+	const bool scaled = sim_width != width || sim_height != height;
 
-	#pragma omp parallel for
-	for (int step_x = 0; step_x < m_width; step_x += step_size) {
-		int w = step_x + step_size;
-		int h = m_height;
-		for (int i = 0; i < h; i++) {
-			for (int j = step_x; j < w; j++) {
-				simulate_flow(i, j, time);
-			}
-		}
-	}
+	setup(sim_width, sim_height);
 
-	std::swap(m_flux_ping, m_flux_pong);
+	const float scale_x = width / float(sim_width);
+	const float scale_y = height / float(sim_height);
 
 	#pragma omp parallel for
-	for (int step_x = 0; step_x < m_width; step_x += step_size) {
-		int w = step_x + step_size;
-		int h = m_height;
-		for (int i = 0; i < h; i++) {
-			for (int j = step_x; j < w; j++) {
-				update_water_velocity(i, j, time);
+	for (int y = 0; y < m_height; y++) {
+		float *row = &m_terrain[(y + 1) * m_stride + 1];
+		for (int x = 0; x < m_width; x++) {
+			if (scaled) {
+				row[x] = image.sample_bilinear((x + 0.5f) / m_width, (y + 0.5f) / m_height, CHANNEL_RED);
+			} else {
+				row[x] = image.sample_unchecked(x, y, CHANNEL_RED);
 			}
 		}
 	}
 
-	std::swap(m_water_ping, m_water_pong);
+	fill_terrain_border();
 
-	#pragma omp parallel for
-	for (int step_x = 0; step_x < m_width; step_x += step_size) {
-		int w = step_x + step_size;
-		int h = m_height;
-		for (int i = 0; i < h; i++) {
-			for (int j = step_x; j < w; j++) {
-				erosion_deposition(i, j);
-			}
-		}
-	}
+	const std::vector<float> original = m_terrain;
 
-	std::swap(m_sediment_ping, m_sediment_pong);
-	std::swap(m_terrain_ping, m_terrain_pong);
+	simulate(iterations);
 
-	#pragma omp parallel for
-	for (int step_x = 0; step_x < m_width; step_x += step_size) {
-		int w = step_x + step_size;
-		int h = m_height;
-		for (int i = 0; i < h; i++) {
-			for (int j = step_x; j < w; j++) {
-				transport_sediment(i, j, time);
+	if (!scaled) {
+		#pragma omp parallel for
+		for (int y = 0; y < height; y++) {
+			const float *row = &m_terrain[(y + 1) * m_stride + 1];
+			for (int x = 0; x < width; x++) {
+				image.plot_unchecked(x, y, CHANNEL_RED, row[x]);
 			}
 		}
+		return;
 	}
 
-	std::swap(m_sediment_ping, m_sediment_pong);
+	// scale up only the height change so the full resolution detail is kept
+	std::vector<float> &change = m_terrain_next;
+	for (size_t i = 0; i < change.size(); i++) {
+		change[i] = m_terrain[i] - original[i];
+	}
+	// the border repeats the edge so the edge pixels blend with themselves
+	const int last_x = m_width + 1;
+	const int last_y = m_height + 1;
+	for (int y = 0; y <= last_y; y++) {
+		change[y * m_stride] = change[y * m_stride + 1];
+		change[y * m_stride + last_x] = change[y * m_stride + last_x - 1];
+	}
+	std::copy_n(&change[m_stride], m_stride, &change[0]);
+	std::copy_n(&change[(last_y - 1) * m_stride], m_stride, &change[last_y * m_stride]);
 
 	#pragma omp parallel for
-	for (int step_x = 0; step_x < m_width; step_x += step_size) {
-		int w = step_x + step_size;
-		int h = m_height;
-		for (int i = 0; i < h; i++) {
-			for (int j = step_x; j < w; j++) {
-				evaporate_water(i, j, time);
-			}
+	for (int y = 0; y < height; y++) {
+		const float sim_y = glm::clamp((y + 0.5f) / scale_y - 0.5f, -1.f, float(m_height));
+		for (int x = 0; x < width; x++) {
+			const float sim_x = glm::clamp((x + 0.5f) / scale_x - 0.5f, -1.f, float(m_width));
+			float delta = bilinear(change.data(), m_stride, std::min(sim_x, m_width - 0.001f), std::min(sim_y, m_height - 0.001f));
+			float value = image.sample_unchecked(x, y, CHANNEL_RED) + delta;
+			image.plot_unchecked(x, y, CHANNEL_RED, glm::clamp(value, 0.f, 1.f));
 		}
 	}
-
-	std::swap(m_water_ping, m_water_pong);
 }
-	
-// add amount of water arriving in a time frame
-void Eroder::increment_water(int x, int y, float time)
+
+void Eroder::setup(int width, int height)
 {
-	float rain = 0.01f; // fixed amount of rain
-	// update water height
-	float water = m_water_ping.sample(x, y, CHANNEL_RED);
-	float d = water + time * rain;
-	m_water_pong.plot(x, y, CHANNEL_RED, d);
+	m_width = width;
+	m_height = height;
+	m_stride = width + 2;
+
+	const size_t size = m_stride * (height + 2);
+
+	// the border cells stay zero so water and sediment never come in from outside the map
+	for (auto plane : { &m_terrain, &m_terrain_next, &m_water, &m_sediment, &m_sediment_next, &m_flux_left, &m_flux_right, &m_flux_top, &m_flux_bottom, &m_velocity_x, &m_velocity_y }) {
+		plane->assign(size, 0.f);
+	}
 }
 
-void Eroder::simulate_flow(int x, int y, float time)
+// the terrain border repeats the edge cells so the map edge does not look like a cliff
+void Eroder::fill_terrain_border()
 {
-	float A = l * l; // pipe area
-	float g = 0.8f; // gravity
-			//
-	float f_left = m_flux_ping.sample(x, y, LEFT);
-	float f_right = m_flux_ping.sample(x, y, RIGHT);
-	float f_bottom = m_flux_ping.sample(x, y, BOTTOM);
-	float f_top = m_flux_ping.sample(x, y, TOP);
-
-	// terrain height data
-	float top = m_terrain_ping.sample(x, y + 1, CHANNEL_RED);
-	float bottom = m_terrain_ping.sample(x, y - 1, CHANNEL_RED);
-	float right = m_terrain_ping.sample(x + 1, y, CHANNEL_RED);
-	float left = m_terrain_ping.sample(x - 1, y, CHANNEL_RED);
-
-	float b = m_terrain_ping.sample(x, y, CHANNEL_RED);
-
-	// water height data
-	float w_top = m_water_ping.sample(x, y + 1, CHANNEL_RED);
-	float w_bottom = m_water_ping.sample(x, y - 1, CHANNEL_RED);
-	float w_right = m_water_ping.sample(x + 1, y, CHANNEL_RED);
-	float w_left = m_water_ping.sample(x - 1, y, CHANNEL_RED);
-
-	float d = m_water_ping.sample(x, y, CHANNEL_RED);
-
-	// height difference between this cell and neighbor cells
-	float h_left = (b + d) - (left + w_left);
-	float h_right = (b + d) - (right + w_right);
-	float h_top = (b + d) - (top + w_top);
-	float h_bottom = (b + d) - (bottom + w_bottom);
-
-	// compute the outgoing amount of water from the current cell to the neighbors
-	float f_L = output_flow(A, g, l, h_left, f_left, time);
-	float f_R = output_flow(A, g, l, h_right, f_right, time);
-	float f_T = output_flow(A, g, l, h_top, f_top, time);
-	float f_B = output_flow(A, g, l, h_bottom, f_bottom, time);
-
-	// scaling factor K for the outflow flux
-	float K = std::min(1.f, (d * l * l) / ((f_L + f_R + f_T + f_B) * time)); 
-
-	// scale output flux by K
-	f_L *= K;
-	f_R *= K;
-	f_T *= K;
-	f_B *= K;
-
-	// deal with boundary conditions
-	// water can't leave the map
-	if (x <= 0) { f_L = 0.f; }
-	if (x >= m_width - 1) { f_R = 0.f; }
-	if (y <= 0) { f_B = 0.f; }
-	if (y >= m_height - 1) { f_T = 0.f; }
-
-	m_flux_pong.plot(x, y, LEFT, f_L);
-	m_flux_pong.plot(x, y, RIGHT, f_R);
-	m_flux_pong.plot(x, y, BOTTOM, f_B);
-	m_flux_pong.plot(x, y, TOP, f_T);
+	const int last_x = m_width + 1;
+	const int last_y = m_height + 1;
+	for (int y = 1; y < last_y; y++) {
+		m_terrain[y * m_stride] = m_terrain[y * m_stride + 1];
+		m_terrain[y * m_stride + last_x] = m_terrain[y * m_stride + last_x - 1];
+	}
+	std::copy_n(&m_terrain[m_stride], m_stride, &m_terrain[0]);
+	std::copy_n(&m_terrain[(last_y - 1) * m_stride], m_stride, &m_terrain[last_y * m_stride]);
 }
-	
-void Eroder::update_water_velocity(int x, int y, float time)
+
+void Eroder::simulate(int iterations)
 {
-	//float l = 1.f; // pipe length
-		       //
-	/* The water height is updated with the new outflow flux field
-	by collecting the inflow flux fin from neighbor cells, and
-	sending the outflow flux fout away from the current cell. */
-
-	// incoming flow is the outgoing flow from neighbor cells in opposite directions
-	float top_in = m_flux_ping.sample(x, y + 1, BOTTOM);
-	float bottom_in = m_flux_ping.sample(x, y - 1, TOP);
-	float right_in = m_flux_ping.sample(x + 1, y, LEFT);
-	float left_in = m_flux_ping.sample(x - 1, y, RIGHT);
-
-	float top_out = m_flux_ping.sample(x, y, TOP);
-	float bottom_out = m_flux_ping.sample(x, y, BOTTOM);
-	float right_out = m_flux_ping.sample(x, y, RIGHT);
-	float left_out = m_flux_ping.sample(x, y, LEFT);
-
-	float inflow_flux = top_in + bottom_in + right_in + left_in;
-	float outflow_flux = bottom_out + top_out + left_out + right_out; 
-
-	float volume_change = time * (inflow_flux - outflow_flux);
-
-	// update water height
-	float d1 = m_water_ping.sample(x, y, CHANNEL_RED);
-	float d2 = d1 + (volume_change / (l * l));
-			
-	// update the velocity vector field
-	// the velocity field is calculated from the outflow flux
-	float W_x = 0.5f * (left_in - left_out + right_out - right_in);
-	float W_y = 0.5f * (bottom_in - bottom_out + top_out - top_in);
-
-	float da = 0.5f * (d1 + d2);
-
-	if (d1 < 0.01f || da < 0.0001f) {
-		W_x = 0.f;
-		W_y = 0.f;
-	}
+	const float time = TIME_STEP;
 
-	// deal with boundary conditions
-	/*
-	if (x >= m_width - 1 || x <= 0 || y >= m_height - 1 || y <= 0) {
-		W_x = 0.f;
-		W_y = 0.f;
-	}
-	*/
+	// every pass works on rows that only depend on the previous pass
+	// so one parallel region runs all iterations with a barrier between the passes
+	#pragma omp parallel
+	{
+		for (int i = 0; i < iterations; i++) {
+			#pragma omp for schedule(static)
+			for (int y = 0; y < m_height; y++) {
+				simulate_flow(y, time);
+			}
 
-	m_water_pong.plot(x, y, CHANNEL_RED, d2);
+			#pragma omp for schedule(static)
+			for (int y = 0; y < m_height; y++) {
+				update_water_velocity(y, time);
+			}
 
-	m_velocity.plot(x, y, CHANNEL_RED, W_x);
-	m_velocity.plot(x, y, CHANNEL_GREEN, W_y);
-}
-	
-// erode soil and deposit some
-void Eroder::erosion_deposition(int x, int y)
-{
-	const float Ks = 0.025; // dissolving constant
-	const float Kd = 0.025; // deposition constant
-	// sediment transport capacity constant Kc
-	const float Kc = 0.08F;
-
-	float tilt_angle = terrain_slope(x, y);
-	tilt_angle = abs(sqrtf(1.f - tilt_angle * tilt_angle));
-
-	// for very flat terrains the angle will be close to 0
-	// so limit it
-	tilt_angle = std::max(0.1f, tilt_angle) ;
-
-	float v_x = m_velocity.sample(x, y, CHANNEL_RED);
-	float v_y = m_velocity.sample(x, y, CHANNEL_GREEN);
-	float v = sqrtf(v_x * v_x + v_y * v_y);
-
-	// sediment transport capacity C
-	float C = Kc * sin(tilt_angle) * v;
-
-	float st = m_sediment_ping.sample(x, y, CHANNEL_RED);
-
-	// current terrain height
-	float d = m_terrain_ping.sample(x, y, CHANNEL_RED);
-
-	float s1 = 0.f;
-	float d1 = 0.f;
-
-	// compare C with the suspended sediment amount s to decide the erosion-deposition process
-	// if C > st some soil is dissolved into the water and added to the suspended sediment
-	if (C > st) {
-		float soil = Ks * (C - st);
-		d1 = d - soil; // remove soil from terrain
-		s1 = st + soil; // add soil to sediment
-	} else if (C <= st) {
-		// deposit sediment
-		float soil = Kd * (st - C);
-		d1 = d + soil;
-		s1 = st - soil;
-	}
+			#pragma omp for schedule(static)
+			for (int y = 0; y < m_height; y++) {
+				erosion_deposition(y);
+			}
 
-	// clamp height
-	if (d1 > 1.f) {
-		d1 = 1.f;
-	} else if (d1 < 0.f) {
-		d1 = 0.f;
-	}
+			#pragma omp single
+			{
+				std::swap(m_terrain, m_terrain_next);
+				fill_terrain_border();
+			}
+
+			#pragma omp for schedule(static)
+			for (int y = 0; y < m_height; y++) {
+				transport_sediment(y, time);
+			}
 
-	m_terrain_pong.plot(x, y, CHANNEL_RED, d1);
-	m_sediment_pong.plot(x, y, CHANNEL_RED, s1);
+			#pragma omp single
+			std::swap(m_sediment, m_sediment_next);
+		}
+	}
 }
-	
-void Eroder::transport_sediment(int x, int y, float time)
-{
-	// the updated sediment is transported by the flow velocity vector
-	float v_x = m_velocity.sample(x, y, CHANNEL_RED);
-	float v_y = m_velocity.sample(x, y, CHANNEL_GREEN);
 
-	// semi-Lagrangian advection method
-	float back_x = x - v_x * time;
-	float back_y = y - v_y * time;
+// outgoing flux to the four neighbors
+// rain is added to the water heights on the fly, the water map itself is updated in the next pass
+void Eroder::simulate_flow(int y, float time)
+{
+	const int row = (y + 1) * m_stride + 1;
+	const int width = m_width;
+	const int stride = m_stride;
+	const float *terrain = &m_terrain[row];
+	const float *water = &m_water[row];
+	float *flux_left = &m_flux_left[row];
+	float *flux_right = &m_flux_right[row];
+	float *flux_top = &m_flux_top[row];
+	float *flux_bottom = &m_flux_bottom[row];
+
+	const float rain = time * RAIN;
+	const float pressure = time * PIPE_AREA * GRAVITY / PIPE_LENGTH;
+	// water can't leave the map
+	const float bottom_open = (y > 0) ? 1.f : 0.f;
+	const float top_open = (y < m_height - 1) ? 1.f : 0.f;
+
+	#pragma omp simd
+	for (int x = 0; x < width; x++) {
+		const float d = water[x] + rain;
+		const float level = terrain[x] + d;
+
+		// height difference between this cell and neighbor cells
+		const float h_left = level - (terrain[x - 1] + water[x - 1] + rain);
+		const float h_right = level - (terrain[x + 1] + water[x + 1] + rain);
+		const float h_top = level - (terrain[x + stride] + water[x + stride] + rain);
+		const float h_bottom = level - (terrain[x - stride] + water[x - stride] + rain);
+
+		float f_L = std::max(0.f, flux_left[x] + pressure * h_left);
+		float f_R = std::max(0.f, flux_right[x] + pressure * h_right);
+		float f_T = top_open * std::max(0.f, flux_top[x] + pressure * h_top);
+		float f_B = bottom_open * std::max(0.f, flux_bottom[x] + pressure * h_bottom);
+
+		// scaling factor K so the outflow never exceeds the water in the cell
+		const float outflow = (f_L + f_R + f_T + f_B) * time;
+		const float K = (outflow > 0.f) ? std::min(1.f, (d * PIPE_AREA) / outflow) : 1.f;
+
+		flux_left[x] = f_L * K;
+		flux_right[x] = f_R * K;
+		flux_top[x] = f_T * K;
+		flux_bottom[x] = f_B * K;
+	}
 
-	float st = m_sediment_ping.sample(back_x, back_y, CHANNEL_RED);
+	flux_left[0] = 0.f;
+	flux_right[m_width - 1] = 0.f;
+}
 
-	m_sediment_pong.plot(x, y, CHANNEL_RED, st);
+// water height from the in and outgoing flux, the velocity field follows from the flux
+// evaporation is applied right after
+void Eroder::update_water_velocity(int y, float time)
+{
+	const int row = (y + 1) * m_stride + 1;
+	const int width = m_width;
+	const int stride = m_stride;
+	float *water = &m_water[row];
+	const float *flux_left = &m_flux_left[row];
+	const float *flux_right = &m_flux_right[row];
+	const float *flux_top = &m_flux_top[row];
+	const float *flux_bottom = &m_flux_bottom[row];
+	float *velocity_x = &m_velocity_x[row];
+	float *velocity_y = &m_velocity_y[row];
+
+	const float rain = time * RAIN;
+	const float evaporation = 1.f - EVAPORATION * time;
+
+	#pragma omp simd
+	for (int x = 0; x < width; x++) {
+		// incoming flow is the outgoing flow from neighbor cells in opposite directions
+		const float top_in = flux_bottom[x + stride];
+		const float bottom_in = flux_top[x - stride];
+		const float right_in = flux_left[x + 1];
+		const float left_in = flux_right[x - 1];
+
+		const float inflow = top_in + bottom_in + right_in + left_in;
+		const float outflow = flux_bottom[x] + flux_top[x] + flux_left[x] + flux_right[x];
+
+		const float d1 = water[x] + rain;
+		const float d2 = d1 + time * (inflow - outflow) / PIPE_AREA;
+		const float da = 0.5f * (d1 + d2);
+
+		const float W_x = 0.5f * (left_in - flux_left[x] + flux_right[x] - right_in);
+		const float W_y = 0.5f * (bottom_in - flux_bottom[x] + flux_top[x] - top_in);
+		// barely any water means no flow
+		const bool still = (d1 < 0.01f) | (da < 0.0001f);
+
+		water[x] = d2 * evaporation;
+		velocity_x[x] = still ? 0.f : W_x;
+		velocity_y[x] = still ? 0.f : W_y;
+	}
 }
-	
-void Eroder::evaporate_water(int x, int y, float time)
+
+// erode soil and deposit some
+void Eroder::erosion_deposition(int y)
 {
-	const float Ke = 0.4; // evaporation constant Ke
-	
-	float d2 = m_water_ping.sample(x, y, CHANNEL_RED);
+	const int row = (y + 1) * m_stride + 1;
+	const int width = m_width;
+	const int stride = m_stride;
+	const float *terrain = &m_terrain[row];
+	float *terrain_next = &m_terrain_next[row];
+	float *sediment = &m_sediment[row];
+	const float *velocity_x = &m_velocity_x[row];
+	const float *velocity_y = &m_velocity_y[row];
+
+	#pragma omp simd
+	for (int x = 0; x < width; x++) {
+		// slope from the terrain normal
+		const float nx = terrain[x - 1] - terrain[x + 1];
+		const float nz = terrain[x + stride] - terrain[x - stride];
+		const float ny = 2.f / std::sqrt(nx * nx + 4.f + nz * nz);
+		// for very flat terrains the angle will be close to 0 so limit it
+		const float tilt = std::max(0.1f, std::sqrt(std::max(0.f, 1.f - ny * ny)));
+
+		const float v = std::sqrt(velocity_x[x] * velocity_x[x] + velocity_y[x] * velocity_y[x]);
+
+		// sediment transport capacity C
+		const float C = CAPACITY * sine(tilt) * v;
+
+		const float st = sediment[x];
+		const float d = terrain[x];
+
+		// if C > st some soil is dissolved into the water and added to the suspended sediment
+		// otherwise sediment is deposited
+		const float rate = (C > st) ? DISSOLVING : DEPOSITION;
+		const float soil = rate * (C - st);
+
+		terrain_next[x] = std::clamp(d - soil, 0.f, 1.f);
+		sediment[x] = st + soil;
+	}
+}
 
-	float dt = d2 * (1.f - Ke * time);
-	
-	m_water_pong.plot(x, y, CHANNEL_RED, dt);
+// the updated sediment is transported by the flow velocity vector
+// semi-Lagrangian advection, sediment from outside the map is zero
+void Eroder::transport_sediment(int y, float time)
+{
+	const int row = (y + 1) * m_stride + 1;
+	const int width = m_width;
+	const int stride = m_stride;
+	const float *sediment = m_sediment.data();
+	float *sediment_next = &m_sediment_next[row];
+	const float *velocity_x = &m_velocity_x[row];
+	const float *velocity_y = &m_velocity_y[row];
+
+	const float max_x = m_width - 0.001f;
+	const float max_y = m_height - 0.001f;
+
+	#pragma omp simd
+	for (int x = 0; x < width; x++) {
+		const float back_x = std::clamp(x - velocity_x[x] * time, -1.f, max_x);
+		const float back_y = std::clamp(y - velocity_y[x] * time, -1.f, max_y);
+
+		sediment_next[x] = bilinear(sediment, stride, back_x, back_y);
+	}
 }
 
 };
@@ -1,38 +1,39 @@
-namespace util {
 
-enum : uint8_t {
-	LEFT = 0,
-	RIGHT = 1,
-	TOP = 2,
-	BOTTOM = 3
-};
+namespace util {
 
+// hydraulic erosion based on the virtual pipe model
+// water flows between neighbor cells, dissolves soil where it flows fast and deposits it where it slows down
+// every map is a plane of floats with a one cell border so the kernels never need bounds checks
 class Eroder {
 public:
-	void erode(Image<float> &image);
+	// erodes the image channel for a number of iterations
+	// if resolution is smaller than the image the simulation runs on a downscaled copy
+	// and only the height change is scaled back up and added to the image
+	void erode(Image<float> &image, int iterations, int resolution);
 private:
 	int m_width = 0;
 	int m_height = 0;
-	Image<float> m_terrain_ping;
-	Image<float> m_terrain_pong;
-	Image<float> m_water_ping;
-	Image<float> m_water_pong;
-	Image<float> m_flux_ping;
-	Image<float> m_flux_pong;
-	Image<float> m_sediment_ping;
-	Image<float> m_sediment_pong;
-	Image<float> m_velocity;
-private:
-	void erosion_step(float time);
+	int m_stride = 0; // width including the border
+	std::vector<float> m_terrain;
+	std::vector<float> m_terrain_next;
+	std::vector<float> m_water;
+	std::vector<float> m_sediment;
+	std::vector<float> m_sediment_next;
+	std::vector<float> m_flux_left;
+	std::vector<float> m_flux_right;
+	std::vector<float> m_flux_top;
+	std::vector<float> m_flux_bottom;
+	std::vector<float> m_velocity_x;
+	std::vector<float> m_velocity_y;
 private:
-	void increment_water(int x, int y, float time);
-	void simulate_flow(int x, int y, float time);
-	void update_water_velocity(int x, int y, float time);
-	void erosion_deposition(int x, int y);
-	void transport_sediment(int x, int y, float time);
-	void evaporate_water(int x, int y, float time);
+	void setup(int width, int height);
+	void simulate(int iterations);
+	void fill_terrain_border();
 private:
-	float terrain_slope(int x, int y) const;
+	void simulate_flow(int y, float time);
+	void update_water_velocity(int y, float time);
+	void erosion_deposition(int y);
+	void transport_sediment(int y, float time);
 };
 
 };
@@ -0,0 +1,258 @@
+#include <cstdint>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+#include "image.h"
+#include "heightpyramid.h"
+
+namespace util {
+
+// narrows the part of the ray between t0 and t1 to the part inside a rectangle, false if nothing is left
+static bool clip_ray(const glm::vec2 &origin, const glm::vec2 &direction, const glm::vec2 &min, const glm::vec2 &max, float &t0, float &t1)
+{
+	for (int axis = 0; axis < 2; axis++) {
+		if (direction[axis] == 0.f) {
+			if (origin[axis] < min[axis] || origin[axis] > max[axis]) {
+				return false;
+			}
+			continue;
+		}
+		const float inverse = 1.f / direction[axis];
+		float near = (min[axis] - origin[axis]) * inverse;
+		float far = (max[axis] - origin[axis]) * inverse;
+		if (near > far) {
+			std::swap(near, far);
+		}
+		t0 = (std::max)(t0, near);
+		t1 = (std::min)(t1, far);
+	}
+
+	return t0 <= t1;
+}
+
+void HeightPyramid::build(const Image<float> &heightmap, uint8_t channel, const glm::vec3 &scale)
+{
+	m_heightmap = &heightmap;
+	m_channel = channel;
+	m_scale = scale;
+	m_quad_width = heightmap.width() - 1;
+	m_quad_height = heightmap.height() - 1;
+	m_levels.clear();
+
+	if (channel >= heightmap.channels() || m_quad_width < 1 || m_quad_height < 1) {
+		return;
+	}
+
+	// the first level comes straight from the texels
+	Level first;
+	first.width = (m_quad_width + 1) / 2;
+	first.height = (m_quad_height + 1) / 2;
+	first.min.resize(first.width * first.height);
+	first.max.resize(first.width * first.height);
+
+	#pragma omp parallel for
+	for (int y = 0; y < first.height; y++) {
+		const int last_y = (std::min)(2 * y + 2, m_quad_height);
+		for (int x = 0; x < first.width; x++) {
+			const int last_x = (std::min)(2 * x + 2, m_quad_width);
+			float low = height(2 * x, 2 * y);
+			float high = low;
+			for (int j = 2 * y; j <= last_y; j++) {
+				for (int i = 2 * x; i <= last_x; i++) {
+					const float value = height(i, j);
+					low = (std::min)(low, value);
+					high = (std::max)(high, value);
+				}
+			}
+			first.min[y * first.width + x] = low;
+			first.max[y * first.width + x] = high;
+		}
+	}
+
+	m_levels.push_back(std::move(first));
+
+	while (m_levels.back().width > 1 || m_levels.back().height > 1) {
+		const Level &below = m_levels.back();
+		Level level;
+		level.width = (below.width + 1) / 2;
+		level.height = (below.height + 1) / 2;
+		level.min.resize(level.width * level.height);
+		level.max.resize(level.width * level.height);
+		for (int y = 0; y < level.height; y++) {
+			const int last_y = (std::min)(2 * y + 1, below.height - 1);
+			for (int x = 0; x < level.width; x++) {
+				const int last_x = (std::min)(2 * x + 1, below.width - 1);
+				float low = below.min[2 * y * below.width + 2 * x];
+				float high = below.max[2 * y * below.width + 2 * x];
+				for (int j = 2 * y; j <= last_y; j++) {
+					for (int i = 2 * x; i <= last_x; i++) {
+						low = (std::min)(low, below.min[j * below.width + i]);
+						high = (std::max)(high, below.max[j * below.width + i]);
+					}
+				}
+				level.min[y * level.width + x] = low;
+				level.max[y * level.width + x] = high;
+			}
+		}
+		m_levels.push_back(std::move(level));
+	}
+}
+
+float HeightPyramid::height_at(const glm::vec2 &position) const
+{
+	if (!m_heightmap) {
+		return 0.f;
+	}
+
+	return m_scale.y * m_heightmap->sample_bilinear(position.x / m_scale.x, position.y / m_scale.z, m_channel);
+}
+
+bool HeightPyramid::intersect_ray(const glm::vec3 &origin, const glm::vec3 &end, glm::vec3 &point) const
+{
+	if (m_levels.empty()) {
+		return false;
+	}
+
+	// to quad coordinates where texel centers are on whole numbers
+	const glm::vec2 texels = glm::vec2(m_heightmap->width(), m_heightmap->height());
+	const glm::vec2 start = { origin.x / m_scale.x * texels.x - 0.5f, origin.z / m_scale.z * texels.y - 0.5f };
+	const glm::vec2 stop = { end.x / m_scale.x * texels.x - 0.5f, end.z / m_scale.z * texels.y - 0.5f };
+
+	Ray ray;
+	ray.origin = start;
+	ray.direction = stop - start;
+	ray.height = origin.y / m_scale.y;
+	ray.climb = (end.y - origin.y) / m_scale.y;
+
+	float t0 = 0.f;
+	float t1 = 1.f;
+	if (!clip_ray(ray.origin, ray.direction, glm::vec2(0.f), glm::vec2(m_quad_width, m_quad_height), t0, t1)) {
+		return false;
+	}
+
+	float t = 0.f;
+	if (!intersect_node(ray, m_levels.size() - 1, 0, 0, t0, t1, t)) {
+		return false;
+	}
+
+	point = origin + t * (end - origin);
+
+	return true;
+}
+
+float HeightPyramid::height(int x, int y) const
+{
+	return m_heightmap->sample_unchecked(x, y, m_channel);
+}
+
+bool HeightPyramid::intersect_quad(const Ray &ray, int x, int y, float t0, float t1, float &t) const
+{
+	const float a = height(x, y);
+	const float b = height(x + 1, y);
+	const float c = height(x, y + 1);
+	const float d = height(x + 1, y + 1);
+	const float e = a - b - c + d;
+
+	// the height of the ray above the bilinear patch is a quadratic in s = t - t0
+	// starting at t0 keeps the terms small so they do not cancel out
+	const float u = ray.origin.x + ray.direction.x * t0 - x;
+	const float v = ray.origin.y + ray.direction.y * t0 - y;
+	const float du = ray.direction.x;
+	const float dv = ray.direction.y;
+	const float A = -e * du * dv;
+	const float B = ray.climb - (b - a) * du - (c - a) * dv - e * (u * dv + v * du);
+	const float C = ray.height + ray.climb * t0 - a - (b - a) * u - (c - a) * v - e * u * v;
+
+	if (C <= 0.f) {
+		t = t0;
+		return true;
+	}
+
+	float roots[2] = { -1.f, -1.f };
+	if (A == 0.f) {
+		if (B != 0.f) {
+			roots[0] = -C / B;
+		}
+	} else {
+		const float discriminant = B * B - 4.f * A * C;
+		if (discriminant < 0.f) {
+			return false;
+		}
+		// the stable form, a tiny A does not cancel out
+		const float q = -0.5f * (B + std::copysign(std::sqrt(discriminant), B));
+		roots[0] = q / A;
+		if (q != 0.f) {
+			roots[1] = C / q;
+		}
+	}
+
+	bool hit = false;
+	float first = t1 - t0;
+	for (float root : roots) {
+		if (root >= 0.f && root <= first) {
+			first = root;
+			hit = true;
+		}
+	}
+	t = t0 + first;
+
+	return hit;
+}
+
+bool HeightPyramid::intersect_node(const Ray &ray, int level, int x, int y, float t0, float t1, float &t) const
+{
+	const Level &node = m_levels[level];
+	const float low = node.min[y * node.width + x];
+	const float high = node.max[y * node.width + x];
+
+	const float h0 = ray.height + ray.climb * t0;
+	const float h1 = ray.height + ray.climb * t1;
+	if ((std::min)(h0, h1) > high) {
+		return false; // passes over
+	}
+	if ((std::max)(h0, h1) < low) {
+		t = t0; // under the surface all the way
+		return true;
+	}
+
+	// the children the ray passes through, visited in the order the ray enters them
+	struct Child {
+		float t0, t1;
+		int x, y;
+	};
+	Child children[4];
+	int count = 0;
+
+	const int size = 1 << level; // of a child in quads
+	const int columns = level > 0 ? m_levels[level - 1].width : m_quad_width;
+	const int rows = level > 0 ? m_levels[level - 1].height : m_quad_height;
+	for (int j = 2 * y; j < (std::min)(2 * y + 2, rows); j++) {
+		for (int i = 2 * x; i < (std::min)(2 * x + 2, columns); i++) {
+			const glm::vec2 min = glm::vec2(i * size, j * size);
+			const glm::vec2 max = glm::vec2((std::min)((i + 1) * size, m_quad_width), (std::min)((j + 1) * size, m_quad_height));
+			Child child = { t0, t1, i, j };
+			if (clip_ray(ray.origin, ray.direction, min, max, child.t0, child.t1)) {
+				int k = count++;
+				for (; k > 0 && children[k - 1].t0 > child.t0; k--) {
+					children[k] = children[k - 1];
+				}
+				children[k] = child;
+			}
+		}
+	}
+
+	for (int k = 0; k < count; k++) {
+		const Child &child = children[k];
+		const bool hit = level > 0
+			? intersect_node(ray, level - 1, child.x, child.y, child.t0, child.t1, t)
+			: intersect_quad(ray, child.x, child.y, child.t0, child.t1, t);
+		if (hit) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+};
@@ -0,0 +1,43 @@
+namespace util {
+
+// min/max mip pyramid over a height map for height and ray queries without the physics world
+// the surface goes bilinearly through the texel centers like the heightfield collision shape
+// and spans the rectangle from the origin to scale.x, scale.z with heights from 0 to scale.y
+// like the heightfield shape it keeps a pointer to the height map so it has to be rebuilt if the height map changes
+class HeightPyramid {
+public:
+	void build(const Image<float> &heightmap, uint8_t channel, const glm::vec3 &scale);
+public:
+	// surface height below a position on the map in world units
+	float height_at(const glm::vec2 &position) const;
+	// first point where the segment from origin to end hits the surface, false if it never does
+	bool intersect_ray(const glm::vec3 &origin, const glm::vec3 &end, glm::vec3 &point) const;
+private:
+	struct Level {
+		int width = 0;
+		int height = 0;
+		std::vector<float> min;
+		std::vector<float> max;
+	};
+	struct Ray {
+		glm::vec2 origin; // in quads
+		glm::vec2 direction;
+		float height; // in height map values
+		float climb;
+	};
+private:
+	const Image<float> *m_heightmap = nullptr;
+	uint8_t m_channel = 0;
+	glm::vec3 m_scale = {};
+	// a quad lies between four texel centers
+	int m_quad_width = 0;
+	int m_quad_height = 0;
+	// level i covers squares of 2^(i+1) quads, the last level is a single square covering the whole map
+	std::vector<Level> m_levels;
+private:
+	float height(int x, int y) const;
+	bool intersect_quad(const Ray &ray, int x, int y, float t0, float t1, float &t) const;
+	bool intersect_node(const Ray &ray, int level, int x, int y, float t0, float t1, float &t) const;
+};
+
+};
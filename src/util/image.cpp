@@ -1,6 +1,9 @@
 #include <iostream>
 #include <cstring>
 #include <vector>
+#include <atomic>
+#include <algorithm>
+#include <type_traits>
 
 #include <glm/glm.hpp>
 #include <glm/vec2.hpp>
@@ -9,37 +12,186 @@
 #include <glm/gtc/type_ptr.hpp>
 
 #include "../extern/fastgaussianblur/fast_gaussian_blur.h"
-#include "../extern/fastgaussianblur/fast_gaussian_blur_template.h"
 
 #include "../geometry/geometry.h"
 #include "image.h"
+#include "tiledimage.h"
 
 namespace util {
 
-template<>
-void Image<uint8_t>::blur(float sigma)
+// transposes a width x height image into a height x width image in cache sized blocks
+template <typename T, int C>
+static void transpose_image(const T *in, T *out, int width, int height)
+{
+	const int BLOCK = 64;
+
+	#pragma omp parallel for collapse(2) schedule(static)
+	for (int y0 = 0; y0 < height; y0 += BLOCK) {
+		for (int x0 = 0; x0 < width; x0 += BLOCK) {
+			const int x1 = std::min(width, x0 + BLOCK);
+			const int y1 = std::min(height, y0 + BLOCK);
+			for (int x = x0; x < x1; x++) {
+				for (int y = y0; y < y1; y++) {
+					for (int k = 0; k < C; k++) {
+						out[(x * height + y) * C + k] = in[(y * width + x) * C + k];
+					}
+				}
+			}
+		}
+	}
+}
+
+template <typename T>
+static void transpose_image(const T *in, T *out, int width, int height, int channels)
+{
+	switch (channels) {
+	case 1: transpose_image<T, 1>(in, out, width, height); break;
+	case 2: transpose_image<T, 2>(in, out, width, height); break;
+	case 3: transpose_image<T, 3>(in, out, width, height); break;
+	case 4: transpose_image<T, 4>(in, out, width, height); break;
+	}
+}
+
+// box blur down the columns
+// a whole strip of a row is updated at once so the running sums are computed with SIMD
+// rows outside the image repeat the edge rows
+template <typename T>
+static void vertical_box_pass(const T *in, T *out, int lanes, int rows, int radius)
 {
-	uint8_t *blurred = new uint8_t[m_raster.size()];
-	uint8_t *input = m_raster.data();
+	const int STRIP = 256;
+	const int strips = (lanes + STRIP - 1) / STRIP;
+	const float scale = 1.f / (radius + radius + 1);
 
-	fast_gaussian_blur_template(input, blurred, m_width, m_height, m_channels, sigma);
+	#pragma omp parallel for schedule(static)
+	for (int strip = 0; strip < strips; strip++) {
+		const int begin = strip * STRIP;
+		const int count = std::min(STRIP, lanes - begin);
+
+		float sum[STRIP];
+
+		const T *first = in + begin;
+		for (int x = 0; x < count; x++) {
+			sum[x] = (radius + 1) * float(first[x]);
+		}
+		for (int j = 0; j < radius; j++) {
+			const T *row = in + std::min(j, rows - 1) * lanes + begin;
+			for (int x = 0; x < count; x++) {
+				sum[x] += float(row[x]);
+			}
+		}
+
+		for (int j = 0; j < rows; j++) {
+			const T *entering = in + std::min(j + radius, rows - 1) * lanes + begin;
+			const T *leaving = in + std::max(j - radius - 1, 0) * lanes + begin;
+			T *destination = out + j * lanes + begin;
+			#pragma omp simd
+			for (int x = 0; x < count; x++) {
+				sum[x] += float(entering[x]) - float(leaving[x]);
+				if constexpr (std::is_integral<T>::value) {
+					destination[x] = sum[x] * scale + 0.5f;
+				} else {
+					destination[x] = sum[x] * scale;
+				}
+			}
+		}
+	}
+}
+
+// blurs the data in place, scratch has to be as large as the data
+// the horizontal passes are vertical passes on the transposed image
+template <typename T>
+static void box_blur(T *data, T *scratch, int width, int height, int channels, float sigma)
+{
+	int boxes[3];
+	sigma_to_box_radius(boxes, sigma, 3);
 
-	std::swap(input, blurred);
+	transpose_image(data, scratch, width, height, channels);
+	vertical_box_pass(scratch, data, height * channels, width, boxes[0]);
+	vertical_box_pass(data, scratch, height * channels, width, boxes[1]);
+	vertical_box_pass(scratch, data, height * channels, width, boxes[2]);
 
-	delete [] blurred;
+	transpose_image(data, scratch, height, width, channels);
+	vertical_box_pass(scratch, data, width * channels, height, boxes[0]);
+	vertical_box_pass(data, scratch, width * channels, height, boxes[1]);
+	vertical_box_pass(scratch, data, width * channels, height, boxes[2]);
+}
+
+template <class T>
+static void blur_image(std::vector<T> &raster, int width, int height, int channels, float sigma, BlurScratch<T> &scratch)
+{
+	if (raster.empty()) {
+		return;
+	}
+
+	scratch.buffer.resize(raster.size());
+
+	box_blur(raster.data(), scratch.buffer.data(), width, height, channels, sigma);
+}
+
+template <class T>
+static void blur_image_channel(std::vector<T> &raster, int width, int height, int channels, uint8_t channel, float sigma, BlurScratch<T> &scratch)
+{
+	if (channel >= channels) {
+		return;
+	}
+	if (channels == 1) {
+		blur_image(raster, width, height, channels, sigma, scratch);
+		return;
+	}
+
+	const int size = width * height;
+	scratch.plane.resize(size);
+	scratch.buffer.resize(size);
+
+	#pragma omp parallel for
+	for (int i = 0; i < size; i++) {
+		scratch.plane[i] = raster[i * channels + channel];
+	}
+
+	box_blur(scratch.plane.data(), scratch.buffer.data(), width, height, 1, sigma);
+
+	#pragma omp parallel for
+	for (int i = 0; i < size; i++) {
+		raster[i * channels + channel] = scratch.plane[i];
+	}
 }
 
 template<>
-void Image<float>::blur(float sigma)
+void Image<uint8_t>::blur(float sigma, BlurScratch<uint8_t> &scratch)
 {
-	float *blurred = new float[m_raster.size()];
-	float *input = m_raster.data();
+	blur_image(m_raster, m_width, m_height, m_channels, sigma, scratch);
+}
 
-	fast_gaussian_blur_template(input, blurred, m_width, m_height, m_channels, sigma);
+template<>
+void Image<float>::blur(float sigma, BlurScratch<float> &scratch)
+{
+	blur_image(m_raster, m_width, m_height, m_channels, sigma, scratch);
+}
+
+template<>
+void Image<uint8_t>::blur(float sigma)
+{
+	BlurScratch<uint8_t> scratch;
+	blur(sigma, scratch);
+}
+
+template<>
+void Image<float>::blur(float sigma)
+{
+	BlurScratch<float> scratch;
+	blur(sigma, scratch);
+}
 
-	std::swap(input, blurred);
+template<>
+void Image<uint8_t>::blur_channel(uint8_t channel, float sigma, BlurScratch<uint8_t> &scratch)
+{
+	blur_image_channel(m_raster, m_width, m_height, m_channels, channel, sigma, scratch);
+}
 
-	delete [] blurred;
+template<>
+void Image<float>::blur_channel(uint8_t channel, float sigma, BlurScratch<float> &scratch)
+{
+	blur_image_channel(m_raster, m_width, m_height, m_channels, channel, sigma, scratch);
 }
 
 template<>
@@ -80,4 +232,101 @@ void Image<float>::normalize(uint8_t channel)
 	}
 }
 
+// blurs every tile that is within reach of an allocated tile
+// each tile is blurred as a separate region with an apron around it as wide as the combined box radii,
+// outside of the apron the box passes can not reach the tile, so the tile gets the same result as a blur of the whole image
+template <class T>
+static void blur_tiles(TiledImage<T> &image, float sigma)
+{
+	const int size = TiledImage<T>::TILE_SIZE;
+	const int channels = image.channels();
+
+	int boxes[3];
+	sigma_to_box_radius(boxes, sigma, 3);
+	const int apron = boxes[0] + boxes[1] + boxes[2];
+	const int reach = (apron + size - 1) / size;
+
+	// find the tiles that will not be empty after the blur
+	std::vector<int> jobs;
+	for (int tile_y = 0; tile_y < image.tiles_y(); tile_y++) {
+		for (int tile_x = 0; tile_x < image.tiles_x(); tile_x++) {
+			bool touched = false;
+			for (int y = std::max(0, tile_y - reach); y <= std::min(image.tiles_y() - 1, tile_y + reach) && !touched; y++) {
+				for (int x = std::max(0, tile_x - reach); x <= std::min(image.tiles_x() - 1, tile_x + reach); x++) {
+					if (image.tile(x, y)) {
+						touched = true;
+						break;
+					}
+				}
+			}
+			if (touched) {
+				jobs.push_back(tile_y * image.tiles_x() + tile_x);
+			}
+		}
+	}
+
+	TiledImage<T> blurred;
+	blurred.resize(image.width(), image.height(), channels);
+
+	#pragma omp parallel
+	{
+		std::vector<T> input;
+		std::vector<T> scratch;
+
+		#pragma omp for schedule(dynamic)
+		for (int i = 0; i < int(jobs.size()); i++) {
+			const int tile_x = jobs[i] % image.tiles_x();
+			const int tile_y = jobs[i] / image.tiles_x();
+
+			// region of the tile with its apron, clipped to the image
+			const int x0 = std::max(0, tile_x * size - apron);
+			const int y0 = std::max(0, tile_y * size - apron);
+			const int x1 = std::min(image.width(), (tile_x + 1) * size + apron);
+			const int y1 = std::min(image.height(), (tile_y + 1) * size + apron);
+			const int width = x1 - x0;
+			const int height = y1 - y0;
+
+			input.resize(width * height * channels);
+			scratch.resize(width * height * channels);
+			image.read_region(x0, y0, width, height, input.data());
+
+			box_blur(input.data(), scratch.data(), width, height, channels, sigma);
+
+			// copy the tile part back, tiles that blurred to nothing stay empty
+			const int tx0 = tile_x * size;
+			const int ty0 = tile_y * size;
+			const int tx1 = std::min(tx0 + size, image.width());
+			const int ty1 = std::min(ty0 + size, image.height());
+			const int span = (tx1 - tx0) * channels;
+			bool empty = true;
+			for (int y = ty0; y < ty1 && empty; y++) {
+				const T *row = input.data() + ((y - y0) * width + (tx0 - x0)) * channels;
+				empty = std::all_of(row, row + span, [](T value) { return value == T(0); });
+			}
+			if (empty) {
+				continue;
+			}
+			T *data = blurred.allocate_tile(tile_x, tile_y);
+			for (int y = ty0; y < ty1; y++) {
+				const T *row = input.data() + ((y - y0) * width + (tx0 - x0)) * channels;
+				std::copy(row, row + span, data + (y - ty0) * size * channels);
+			}
+		}
+	}
+
+	image.swap(blurred);
+}
+
+template<>
+void TiledImage<uint8_t>::blur(float sigma)
+{
+	blur_tiles(*this, sigma);
+}
+
+template<>
+void TiledImage<float>::blur(float sigma)
+{
+	blur_tiles(*this, sigma);
+}
+
 };
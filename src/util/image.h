@@ -1,4 +1,6 @@
 #pragma once
+#include <span>
+#include <limits>
 #include "../geometry/geometry.h"
 
 namespace util {
@@ -16,6 +18,14 @@ enum : uint8_t {
 	COLORSPACE_RGBA = 4
 };
 
+// working memory of a blur
+// keep one around to blur many images without allocating every time
+template <class T>
+struct BlurScratch {
+	std::vector<T> buffer;
+	std::vector<T> plane; // a single channel taken out of an image
+};
+
 template <class T>
 class Image {
 public:
@@ -75,6 +85,46 @@ public:
 	{
 		return sample(x * m_width, y * m_height, channel);
 	}
+	// bilinear filtered sample in relative coordinates, texel i is centered on (i + 0.5) / size
+	// coordinates outside the image are clamped to the edge
+	float sample_bilinear(float x, float y, uint8_t channel) const
+	{
+		if (channel >= m_channels || m_raster.empty()) { return 0.f; }
+
+		x = glm::clamp(x * m_width - 0.5f, 0.f, float(m_width - 1));
+		y = glm::clamp(y * m_height - 0.5f, 0.f, float(m_height - 1));
+		const int x0 = x;
+		const int y0 = y;
+		const int x1 = (std::min)(x0 + 1, m_width - 1);
+		const int y1 = (std::min)(y0 + 1, m_height - 1);
+		const float fx = x - x0;
+		const float fy = y - y0;
+
+		const float a = sample_unchecked(x0, y0, channel);
+		const float b = sample_unchecked(x1, y0, channel);
+		const float c = sample_unchecked(x0, y1, channel);
+		const float d = sample_unchecked(x1, y1, channel);
+
+		const float top = a + fx * (b - a);
+		const float bottom = c + fx * (d - c);
+
+		return top + fy * (bottom - top);
+	}
+public: // unchecked access for hot loops, the caller makes sure the coordinates and channel are inside the image
+	T sample_unchecked(int x, int y, uint8_t channel) const
+	{
+		return m_raster[(size_t(y) * m_width + x) * m_channels + channel];
+	}
+	void plot_unchecked(int x, int y, uint8_t channel, T color)
+	{
+		m_raster[(size_t(y) * m_width + x) * m_channels + channel] = color;
+	}
+	// start of a row, the channels of a pixel are next to each other
+	// so the samples of one channel are channels() apart
+	T* row(int y) { return m_raster.data() + size_t(y) * stride(); }
+	const T* row(int y) const { return m_raster.data() + size_t(y) * stride(); }
+	// number of samples from the start of a row to the start of the next
+	size_t stride() const { return size_t(m_width) * m_channels; }
 public: // rasterize methods
 	// line drawing
 	void draw_line(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1, uint8_t channel, T color)
@@ -291,8 +341,53 @@ public:
 
 		find_triangle_pixels(a_coords, b_coords, c_coords, output);
 	}
+	// scanline fill of a convex polygon given by its edges in pixel coordinates, in any order
+	// a pixel is inside if its center is, with the left and top edges inclusive
+	// so polygons sharing an edge never cover the same pixel and leave no gaps
+	// calls visit_span(y, x0, x1) for every row with pixels x0 up to but not including x1
+	// only the rows from first_row up to but not including last_row are visited
+	template <typename F>
+	void fill_convex_polygon(std::span<const geom::Segment> outline, int first_row, int last_row, F &&visit_span) const
+	{
+		float min_y = (std::numeric_limits<float>::max)();
+		float max_y = std::numeric_limits<float>::lowest();
+		for (const auto &edge : outline) {
+			min_y = (std::min)(min_y, (std::min)(edge.A.y, edge.B.y));
+			max_y = (std::max)(max_y, (std::max)(edge.A.y, edge.B.y));
+		}
+
+		const int top = (std::max)({ first_row, 0, int(ceilf(min_y - 0.5f)) });
+		const int bottom = (std::min)({ last_row, int(m_height), int(ceilf(max_y - 0.5f)) });
+
+		for (int y = top; y < bottom; y++) {
+			const float center = y + 0.5f;
+			float left = (std::numeric_limits<float>::max)();
+			float right = std::numeric_limits<float>::lowest();
+			for (const auto &edge : outline) {
+				// half open so a vertex on the scanline is only counted once
+				if ((edge.A.y <= center) != (edge.B.y <= center)) {
+					float x = edge.A.x + (center - edge.A.y) * (edge.B.x - edge.A.x) / (edge.B.y - edge.A.y);
+					left = (std::min)(left, x);
+					right = (std::max)(right, x);
+				}
+			}
+			const int x0 = (std::max)(0, int(ceilf(left - 0.5f)));
+			const int x1 = (std::min)(int(m_width), int(ceilf(right - 0.5f)));
+			if (x0 < x1) {
+				visit_span(y, x0, x1);
+			}
+		}
+	}
+	template <typename F>
+	void fill_convex_polygon(std::span<const geom::Segment> outline, F &&visit_span) const
+	{
+		fill_convex_polygon(outline, 0, m_height, visit_span);
+	}
 public:
+	// gaussian blur approximated by three box blurs in both directions
 	void blur(float sigma);
+	void blur(float sigma, BlurScratch<T> &scratch);
+	void blur_channel(uint8_t channel, float sigma, BlurScratch<T> &scratch);
 	void normalize(uint8_t channel);
 public:
 	template <class Archive>
@@ -313,46 +408,4 @@ private:
 	std::vector<T> m_raster;
 };
 
-inline glm::vec3 filter_normal(int x, int y, uint8_t channel, float strength, const Image<uint8_t> &image)
-{
-	float T = image.sample(x, y + 1, channel) / 255.f;
-	float TR = image.sample(x + 1, y + 1, channel) / 255.f;
-	float TL = image.sample(x - 1, y + 1, channel) / 255.f;
-	float B = image.sample(x, y - 1, channel) / 255.f;
-	float BR = image.sample(x + 1, y - 1, channel) / 255.f;
-	float BL = image.sample(x - 1, y - 1, channel) / 255.f;
-	float R = image.sample(x + 1, y, channel) / 255.f;
-	float L = image.sample(x - 1, y, channel) / 255.f;
-
-	// sobel filter
-	const float X = (TR + 2.f * R + BR) - (TL + 2.f * L + BL);
-	const float Z = (BL + 2.f * B + BR) - (TL + 2.f * T + TR);
-	const float Y = 1.f / strength;
-
-	glm::vec3 normal(-X, Y, Z);
-
-	return glm::normalize(normal);
-}
-
-inline glm::vec3 filter_normal(int x, int y, uint8_t channel, float strength, const Image<float> &image)
-{
-	float T = image.sample(x, y + 1, channel);
-	float TR = image.sample(x + 1, y + 1, channel);
-	float TL = image.sample(x - 1, y + 1, channel);
-	float B = image.sample(x, y - 1, channel);
-	float BR = image.sample(x + 1, y - 1, channel);
-	float BL = image.sample(x - 1, y - 1, channel);
-	float R = image.sample(x + 1, y, channel);
-	float L = image.sample(x - 1, y, channel);
-
-	// sobel filter
-	const float X = (TR + 2.f * R + BR) - (TL + 2.f * L + BL);
-	const float Z = (BL + 2.f * B + BR) - (TL + 2.f * T + TR);
-	const float Y = 1.f / strength;
-
-	glm::vec3 normal(-X, Y, Z);
-
-	return glm::normalize(normal);
-}
-
 };
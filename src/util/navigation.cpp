@@ -212,7 +212,20 @@ void Navigation::build_all_tiles(const std::vector<float> &vertices, const std::
 	}
 }
 
+std::unique_ptr<dtNavMeshQuery> Navigation::create_query() const
+{
+	auto query = std::make_unique<dtNavMeshQuery>();
+	query->init(m_navmesh.get(), 2048);
+
+	return query;
+}
+
 void Navigation::find_2D_path(const glm::vec2 &startpos, const glm::vec2 &endpos, std::list<glm::vec2> &pathways) const
+{
+	find_2D_path(m_query.get(), startpos, endpos, pathways);
+}
+
+void Navigation::find_2D_path(const dtNavMeshQuery *query, const glm::vec2 &startpos, const glm::vec2 &endpos, std::list<glm::vec2> &pathways) const
 {
 	const glm::vec3 start = { startpos.x, 0.f, startpos.y };
 	const glm::vec3 end = { endpos.x, 0.f, endpos.y };
@@ -225,7 +238,7 @@ void Navigation::find_2D_path(const glm::vec2 &startpos, const glm::vec2 &endpos
 	// find the start polygon
 	dtPolyRef start_poly;
 	float nearest_start[3];
-	dtStatus status = m_query->findNearestPoly(glm::value_ptr(start), BOX_EXTENTS, &filter, &start_poly, nearest_start);
+	dtStatus status = query->findNearestPoly(glm::value_ptr(start), BOX_EXTENTS, &filter, &start_poly, nearest_start);
 	if ((status & DT_FAILURE) || (status & DT_STATUS_DETAIL_MASK)) {
 		return; 
 	}
@@ -233,14 +246,14 @@ void Navigation::find_2D_path(const glm::vec2 &startpos, const glm::vec2 &endpos
 	// find the end polygon
 	dtPolyRef end_poly;
 	float nearest_end[3];
-	status = m_query->findNearestPoly(glm::value_ptr(end), BOX_EXTENTS, &filter, &end_poly, nearest_end);
+	status = query->findNearestPoly(glm::value_ptr(end), BOX_EXTENTS, &filter, &end_poly, nearest_end);
 	if ((status & DT_FAILURE) || (status & DT_STATUS_DETAIL_MASK)) { 
 		return; 
 	}
 
 	dtPolyRef poly_path[MAX_PATHPOLY];
 	int path_count = 0;
-	status = m_query->findPath(start_poly, end_poly, nearest_start, nearest_end, &filter, poly_path, &path_count, MAX_PATHPOLY);
+	status = query->findPath(start_poly, end_poly, nearest_start, nearest_end, &filter, poly_path, &path_count, MAX_PATHPOLY);
 	if ((status & DT_FAILURE) || (status & DT_STATUS_DETAIL_MASK)) { 
 		return; 
 	}
@@ -250,7 +263,7 @@ void Navigation::find_2D_path(const glm::vec2 &startpos, const glm::vec2 &endpos
 
 	int vert_count = 0;
 	float pathdata[MAX_PATHVERT*3];
-	status = m_query->findStraightPath(nearest_start, nearest_end, poly_path, path_count, pathdata, NULL, NULL, &vert_count, MAX_PATHVERT);
+	status = query->findStraightPath(nearest_start, nearest_end, poly_path, path_count, pathdata, NULL, NULL, &vert_count, MAX_PATHVERT);
 	if ((status & DT_FAILURE) || (status & DT_STATUS_DETAIL_MASK)) { 
 		return; 
 	}
@@ -116,7 +116,10 @@ public:
 public:
 	bool build(const std::vector<float> &vertices, const std::vector<int> &indices);
 public:	
+	// a query keeps search state so every thread that searches paths needs its own
+	std::unique_ptr<dtNavMeshQuery> create_query() const;
 	void find_2D_path(const glm::vec2 &startpos, const glm::vec2 &endpos, std::list<glm::vec2> &pathways) const;
+	void find_2D_path(const dtNavMeshQuery *query, const glm::vec2 &startpos, const glm::vec2 &endpos, std::list<glm::vec2> &pathways) const;
 	void find_3D_path(const glm::vec3 &startpos, const glm::vec3 &endpos, std::vector<glm::vec3> &pathways) const;
 	PolySearchResult point_on_navmesh(const glm::vec3 &point) const;
 public:
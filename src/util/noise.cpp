@@ -1,3 +1,5 @@
+#include <vector>
+
 #include "../extern/fastnoise/FastNoise.h"
 
 #include "image.h"
@@ -5,22 +7,33 @@
 
 namespace util {
 
-void noise_image(Image<float> &image, FastNoise *fastnoise, const glm::vec2 &sample_freq, uint8_t channel)
+void noise_image(Image<float> &image, const FastNoise *fastnoise, const glm::vec2 &sample_freq, uint8_t channel, float amplitude)
 {
-	const int nsteps = 32;
-	const int stepsize = image.width() / nsteps;
+	const int width = image.width();
+	const int height = image.height();
+	const int channels = image.channels();
+	if (channel >= channels) {
+		return;
+	}
 
-	#pragma omp parallel for
-	for (int step_x = 0; step_x < image.width(); step_x += stepsize) {
-		int w = step_x + stepsize;
-		int h = image.height();
-		for (int i = 0; i < h; i++) {
-			for (int j = step_x; j < w; j++) {
-				float x = sample_freq.x * j;
-				float y = sample_freq.y * i;
-				fastnoise->GradientPerturbFractal(x, y);
-				float value = 0.5f * (fastnoise->GetNoise(x, y) + 1.f);
-				image.plot(j, i, channel, glm::clamp(value, 0.f, 1.f));
+	#pragma omp parallel
+	{
+		FastNoise noise = *fastnoise;
+		std::vector<float> xs(width);
+		std::vector<float> ys(width);
+		std::vector<float> values(width);
+
+		#pragma omp for
+		for (int i = 0; i < height; i++) {
+			for (int j = 0; j < width; j++) {
+				xs[j] = sample_freq.x * j;
+				ys[j] = sample_freq.y * i;
+			}
+			noise.GetPerturbedNoiseBatch(xs.data(), ys.data(), values.data(), width);
+			float *row = image.row(i) + channel;
+			for (int j = 0; j < width; j++) {
+				float value = 0.5f * (values[j] + 1.f);
+				row[j * channels] = amplitude * glm::clamp(value, 0.f, 1.f);
 			}
 		}
 	}
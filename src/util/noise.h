@@ -1,6 +1,8 @@
 
 namespace util {
 
-void noise_image(Image<float> &image, FastNoise *fastnoise, const glm::vec2 &sample_freq, uint8_t channel);
+// fills the image channel with perturbed noise in the [0, 1] range
+// every thread samples whole rows with its own copy of the noise state
+void noise_image(Image<float> &image, const FastNoise *fastnoise, const glm::vec2 &sample_freq, uint8_t channel, float amplitude = 1.f);
 
 };
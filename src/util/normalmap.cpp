@@ -0,0 +1,142 @@
+#include <cstdint>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+#include "image.h"
+#include "normalmap.h"
+
+namespace util {
+
+// copies a row of one channel with the edge pixels repeated on both sides
+static void load_padded_row(const Image<float> &heightmap, int y, uint8_t channel, float *padded)
+{
+	const int width = heightmap.width();
+	const int channels = heightmap.channels();
+	const float *row = heightmap.row(glm::clamp(y, 0, heightmap.height() - 1)) + channel;
+
+	for (int x = 0; x < width; x++) {
+		padded[x + 1] = row[x * channels];
+	}
+	padded[0] = padded[1];
+	padded[width + 1] = padded[width];
+}
+
+// filters the height map row by row and hands the normals of every row to store as three planes
+template <typename F>
+static void filter_rows(const Image<float> &heightmap, uint8_t channel, float strength, F &&store)
+{
+	const int width = heightmap.width();
+	const int height = heightmap.height();
+	const float up = 1.f / strength;
+
+	#pragma omp parallel
+	{
+		std::vector<float> above(width + 2);
+		std::vector<float> middle(width + 2);
+		std::vector<float> below(width + 2);
+		std::vector<float> normal_x(width);
+		std::vector<float> normal_y(width);
+		std::vector<float> normal_z(width);
+
+		#pragma omp for schedule(static)
+		for (int y = 0; y < height; y++) {
+			load_padded_row(heightmap, y - 1, channel, above.data());
+			load_padded_row(heightmap, y, channel, middle.data());
+			load_padded_row(heightmap, y + 1, channel, below.data());
+
+			const float *a = above.data();
+			const float *m = middle.data();
+			const float *b = below.data();
+			float *nx = normal_x.data();
+			float *ny = normal_y.data();
+			float *nz = normal_z.data();
+
+			// pixel x is at x + 1 in the padded rows
+			#pragma omp simd
+			for (int x = 0; x < width; x++) {
+				const float gradient_x = (a[x + 2] + 2.f * m[x + 2] + b[x + 2]) - (a[x] + 2.f * m[x] + b[x]);
+				const float gradient_z = (a[x] + 2.f * a[x + 1] + a[x + 2]) - (b[x] + 2.f * b[x + 1] + b[x + 2]);
+				const float length = 1.f / std::sqrt(gradient_x * gradient_x + up * up + gradient_z * gradient_z);
+				nx[x] = -gradient_x * length;
+				ny[x] = up * length;
+				nz[x] = gradient_z * length;
+			}
+
+			store(y, nx, ny, nz);
+		}
+	}
+}
+
+template <class T>
+static void fit_normal_map(const Image<float> &heightmap, Image<T> &normalmap)
+{
+	if (normalmap.width() != heightmap.width() || normalmap.height() != heightmap.height() || normalmap.channels() != COLORSPACE_RGB) {
+		normalmap.resize(heightmap.width(), heightmap.height(), COLORSPACE_RGB);
+	}
+}
+
+void normal_map(const Image<float> &heightmap, uint8_t channel, float strength, Image<float> &normalmap)
+{
+	if (channel >= heightmap.channels()) {
+		return;
+	}
+
+	fit_normal_map(heightmap, normalmap);
+
+	const int width = heightmap.width();
+
+	filter_rows(heightmap, channel, strength, [&](int y, const float *nx, const float *ny, const float *nz) {
+		float *row = normalmap.row(y);
+		for (int x = 0; x < width; x++) {
+			row[3 * x] = nx[x];
+			row[3 * x + 1] = ny[x];
+			row[3 * x + 2] = nz[x];
+		}
+	});
+}
+
+void normal_map(const Image<float> &heightmap, uint8_t channel, float strength, Image<uint8_t> &normalmap)
+{
+	if (channel >= heightmap.channels()) {
+		return;
+	}
+
+	fit_normal_map(heightmap, normalmap);
+
+	const int width = heightmap.width();
+
+	// adding a half before the cast rounds to the nearest byte
+	filter_rows(heightmap, channel, strength, [&](int y, const float *nx, const float *ny, const float *nz) {
+		uint8_t *row = normalmap.row(y);
+		for (int x = 0; x < width; x++) {
+			row[3 * x] = nx[x] * 127.5f + 128.f;
+			row[3 * x + 1] = ny[x] * 127.5f + 128.f;
+			row[3 * x + 2] = nz[x] * 127.5f + 128.f;
+		}
+	});
+}
+
+void normal_map(const Image<float> &heightmap, uint8_t channel, float strength, std::vector<uint32_t> &normalmap)
+{
+	if (channel >= heightmap.channels()) {
+		return;
+	}
+
+	const int width = heightmap.width();
+
+	normalmap.resize(size_t(width) * heightmap.height());
+
+	filter_rows(heightmap, channel, strength, [&](int y, const float *nx, const float *ny, const float *nz) {
+		uint32_t *row = &normalmap[size_t(y) * width];
+		#pragma omp simd
+		for (int x = 0; x < width; x++) {
+			const uint32_t r = std::min(uint32_t(nx[x] * 511.5f + 512.f), 1023u);
+			const uint32_t g = std::min(uint32_t(ny[x] * 511.5f + 512.f), 1023u);
+			const uint32_t b = std::min(uint32_t(nz[x] * 511.5f + 512.f), 1023u);
+			row[x] = r | (g << 10) | (b << 20) | (3u << 30);
+		}
+	});
+}
+
+};
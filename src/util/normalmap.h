@@ -0,0 +1,14 @@
+namespace util {
+
+// normal maps of a height map channel with a Sobel filter, the output is resized to the height map
+// the rows outside the height map repeat the edge rows, a higher strength gives steeper normals
+// every thread filters whole rows, the gradients of a row are computed with SIMD
+// three floats per pixel in the [-1, 1] range
+void normal_map(const Image<float> &heightmap, uint8_t channel, float strength, Image<float> &normalmap);
+// three bytes per pixel, stored as normal * 0.5 + 0.5
+void normal_map(const Image<float> &heightmap, uint8_t channel, float strength, Image<uint8_t> &normalmap);
+// one 32 bit word per pixel, 10 bits per axis stored as normal * 0.5 + 0.5 with x in the lowest bits
+// the same layout as GL_RGB10_A2 with GL_UNSIGNED_INT_2_10_10_10_REV
+void normal_map(const Image<float> &heightmap, uint8_t channel, float strength, std::vector<uint32_t> &normalmap);
+
+};
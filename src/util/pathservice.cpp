@@ -0,0 +1,206 @@
+#include <cstdint>
+#include <algorithm>
+#include <list>
+#include <map>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <glm/glm.hpp>
+
+#include "navigation.h"
+#include "pathservice.h"
+
+namespace util {
+
+PathService::~PathService()
+{
+	stop();
+}
+
+void PathService::start(const Navigation *navigation, int workers)
+{
+	stop();
+
+	m_navigation = navigation;
+	m_running = true;
+
+	for (int i = 0; i < std::max(workers, 1); i++) {
+		m_workers.emplace_back(&PathService::work, this);
+	}
+}
+
+void PathService::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_running = false;
+	}
+	m_work_available.notify_all();
+
+	for (auto &worker : m_workers) {
+		worker.join();
+	}
+	m_workers.clear();
+
+	clear();
+
+	m_navigation = nullptr;
+}
+
+void PathService::request(uint32_t requester, const glm::vec2 &start, const glm::vec2 &end)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		// replace the request if it is still waiting, it keeps its place in the queue
+		auto search = m_requests.find(requester);
+		if (search == m_requests.end()) {
+			m_queue.push_back(requester);
+		}
+		m_requests[requester] = { m_next_ticket++, start, end };
+	}
+	m_work_available.notify_one();
+}
+
+void PathService::cancel(uint32_t requester)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	// the requester stays in the queue, workers skip it
+	m_requests.erase(requester);
+
+	auto search = m_finished_tickets.find(requester);
+	if (search != m_finished_tickets.end()) {
+		m_finished.erase(search->second);
+		m_finished_tickets.erase(search);
+	}
+
+	// a worker might still be busy with it
+	if (m_running_requests.count(requester)) {
+		m_cancelled[requester] = m_next_ticket;
+	}
+
+	lock.unlock();
+	m_idle.notify_all();
+}
+
+void PathService::clear()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_queue.clear();
+		m_requests.clear();
+		m_finished.clear();
+		m_finished_tickets.clear();
+		m_cancelled.clear();
+		// results of workers that are still busy are dropped
+		m_valid_from = m_next_ticket;
+	}
+	m_idle.notify_all();
+}
+
+bool PathService::pending(uint32_t requester) const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	return m_requests.count(requester) || m_running_requests.count(requester) || m_finished_tickets.count(requester);
+}
+
+size_t PathService::collect(std::vector<PathResult> &output, size_t budget)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	size_t count = 0;
+	while (count < budget && !m_finished.empty()) {
+		auto first = m_finished.begin();
+		m_finished_tickets.erase(first->second.requester);
+		output.push_back(std::move(first->second));
+		m_finished.erase(first);
+		count++;
+	}
+
+	return count;
+}
+
+void PathService::wait_idle()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	if (m_workers.empty()) {
+		return;
+	}
+
+	m_idle.wait(lock, [this] { return m_requests.empty() && m_busy == 0; });
+}
+
+bool PathService::stale(uint32_t requester, uint64_t ticket) const
+{
+	if (ticket < m_valid_from) {
+		return true;
+	}
+
+	auto search = m_cancelled.find(requester);
+
+	return search != m_cancelled.end() && ticket < search->second;
+}
+
+void PathService::work()
+{
+	// every worker searches with its own query
+	std::unique_ptr<dtNavMeshQuery> query = m_navigation->create_query();
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (true) {
+		m_work_available.wait(lock, [this] { return !m_running || !m_queue.empty(); });
+		if (!m_running) {
+			return;
+		}
+
+		const uint32_t requester = m_queue.front();
+		m_queue.pop_front();
+		auto search = m_requests.find(requester);
+		if (search == m_requests.end()) {
+			continue; // cancelled while it was waiting
+		}
+		const Request request = search->second;
+		m_requests.erase(search);
+		m_running_requests[requester]++;
+		m_busy++;
+
+		lock.unlock();
+		PathResult result;
+		result.requester = requester;
+		m_navigation->find_2D_path(query.get(), request.start, request.end, result.nodes);
+		lock.lock();
+
+		if (--m_running_requests[requester] == 0) {
+			m_running_requests.erase(requester);
+		}
+
+		if (!stale(requester, request.ticket)) {
+			// only the latest path of a requester is kept
+			auto previous = m_finished_tickets.find(requester);
+			if (previous == m_finished_tickets.end() || previous->second < request.ticket) {
+				if (previous != m_finished_tickets.end()) {
+					m_finished.erase(previous->second);
+				}
+				m_finished_tickets[requester] = request.ticket;
+				m_finished[request.ticket] = std::move(result);
+			}
+		}
+
+		if (m_running_requests.count(requester) == 0) {
+			m_cancelled.erase(requester);
+		}
+
+		m_busy--;
+		if (m_busy == 0 && m_requests.empty()) {
+			m_idle.notify_all();
+		}
+	}
+}
+
+};
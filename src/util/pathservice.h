@@ -0,0 +1,70 @@
+#pragma once
+#include <cstdint>
+#include <list>
+#include <map>
+#include <deque>
+#include <vector>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace util {
+
+class Navigation;
+
+struct PathResult {
+	uint32_t requester = 0;
+	std::list<glm::vec2> nodes;
+};
+
+// finds paths on a pool of worker threads so path finding never stalls a frame
+// every worker has its own navmesh query since a query keeps search state
+// a requester has at most one path in the queue, a new request replaces the one that is still waiting
+// finished paths are kept until they are collected, so they arrive at the earliest the next update
+// the navigation must not change while the service is running
+class PathService {
+public:
+	~PathService();
+public:
+	void start(const Navigation *navigation, int workers);
+	void stop();
+	void request(uint32_t requester, const glm::vec2 &start, const glm::vec2 &end);
+	// drops the queued, running and finished requests of the requester
+	void cancel(uint32_t requester);
+	// drops everything
+	void clear();
+	// true if the requester still has a path coming
+	bool pending(uint32_t requester) const;
+	// moves at most budget finished paths to the output in the order they were requested
+	// returns the number of paths collected
+	size_t collect(std::vector<PathResult> &output, size_t budget);
+	// blocks until every queued request has finished
+	void wait_idle();
+private:
+	struct Request {
+		uint64_t ticket = 0;
+		glm::vec2 start = {};
+		glm::vec2 end = {};
+	};
+	const Navigation *m_navigation = nullptr;
+	std::vector<std::thread> m_workers;
+	mutable std::mutex m_mutex;
+	std::condition_variable m_work_available;
+	std::condition_variable m_idle;
+	bool m_running = false;
+	uint64_t m_next_ticket = 1; // requests are numbered so results can be ordered and stale ones dropped
+	uint64_t m_valid_from = 0; // results of older tickets were cleared
+	std::unordered_map<uint32_t, uint64_t> m_cancelled; // results of the requester older than the ticket are dropped
+	std::deque<uint32_t> m_queue; // requesters in order of their first request
+	std::unordered_map<uint32_t, Request> m_requests; // the latest request of a queued requester
+	std::unordered_map<uint32_t, int> m_running_requests; // requesters that a worker is busy with
+	std::map<uint64_t, PathResult> m_finished; // by ticket so they are collected in a fixed order
+	std::unordered_map<uint32_t, uint64_t> m_finished_tickets; // ticket of the finished path of each requester
+	int m_busy = 0;
+private:
+	void work();
+	bool stale(uint32_t requester, uint64_t ticket) const;
+};
+
+};
@@ -0,0 +1,64 @@
+#pragma once
+#include <atomic>
+#include <algorithm>
+#include <mutex>
+#include <string>
+
+namespace util {
+
+// progress of a long job such as world generation that runs on another thread
+// the job reports every finished stage, any other thread can poll it or ask the job to stop
+// cancelling is cooperative, the job checks for it between its stages
+class Progress {
+public:
+	// prepares for a new job
+	void reset()
+	{
+		m_total = 0;
+		m_finished = 0;
+		m_cancelled = false;
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stage.clear();
+	}
+	// the job announces how many stages it still has to add
+	void add_stages(uint32_t count)
+	{
+		m_total += count;
+	}
+	void finish_stage(const std::string &name)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_stage = name;
+		}
+		m_finished++;
+	}
+	void cancel()
+	{
+		m_cancelled = true;
+	}
+public:
+	bool cancelled() const { return m_cancelled; }
+	uint32_t finished_stages() const { return m_finished; }
+	uint32_t total_stages() const { return m_total; }
+	// between 0 and 1
+	float fraction() const
+	{
+		const uint32_t total = m_total;
+		return (total > 0) ? std::min(1.f, float(m_finished) / float(total)) : 0.f;
+	}
+	// name of the stage that finished last
+	std::string last_stage() const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_stage;
+	}
+private:
+	std::atomic<uint32_t> m_total = 0;
+	std::atomic<uint32_t> m_finished = 0;
+	std::atomic<bool> m_cancelled = false;
+	mutable std::mutex m_mutex;
+	std::string m_stage;
+};
+
+};
@@ -49,6 +49,48 @@ void serialize(Archive &archive, glm::quat &q)
 
 namespace util {
 
+// dense per tile arrays like ownership have long runs of the same value
+// so they are stored as run lengths and run values
+template <class Archive, class T>
+void save_runs(Archive &archive, const std::vector<T> &values)
+{
+	std::vector<uint32_t> lengths;
+	std::vector<T> runs;
+	for (size_t i = 0; i < values.size(); i++) {
+		if (runs.empty() || runs.back() != values[i]) {
+			runs.push_back(values[i]);
+			lengths.push_back(0);
+		}
+		lengths.back()++;
+	}
+
+	archive(uint64_t(values.size()), lengths, runs);
+}
+
+template <class Archive, class T>
+void load_runs(Archive &archive, std::vector<T> &values)
+{
+	uint64_t size = 0;
+	std::vector<uint32_t> lengths;
+	std::vector<T> runs;
+	archive(size, lengths, runs);
+
+	// checked before anything is expanded, a corrupt save could ask for billions of values
+	uint64_t total = 0;
+	for (uint32_t length : lengths) {
+		total += length;
+	}
+	if (lengths.size() != runs.size() || total != size) {
+		throw cereal::Exception("run lengths do not add up to the array size");
+	}
+
+	values.clear();
+	values.reserve(size);
+	for (size_t i = 0; i < runs.size(); i++) {
+		values.insert(values.end(), lengths[i], runs[i]);
+	}
+}
+
 class IdGenerator {
 public:
 	uint32_t generate()
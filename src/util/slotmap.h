@@ -0,0 +1,125 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <utility>
+#include <stdexcept>
+
+namespace util {
+
+// dense storage of entities addressed by handles
+// values stay contiguous so updating every entity walks memory in order
+// erasing moves the last value into the gap, so pointers to values are only valid until the next insert or erase
+// a handle is a slot index and a generation, once a value is erased its old handles no longer find anything
+// a valid handle is never 0 so 0 can still mean no entity
+template <class T>
+class SlotMap {
+public:
+	static const uint32_t INDEX_BITS = 20;
+	static const uint32_t INDEX_MASK = (1 << INDEX_BITS) - 1;
+	static const uint32_t MAX_GENERATION = (1 << (32 - INDEX_BITS)) - 1;
+public:
+	// returns the handle of the new value
+	template <class... Args>
+	uint32_t emplace(Args&&... args)
+	{
+		uint32_t index = 0;
+		if (m_free.empty()) {
+			// the index would spill into the generation bits and alias other handles
+			if (m_slots.size() > INDEX_MASK) {
+				throw std::length_error("slot map has no free handles left");
+			}
+			index = m_slots.size();
+			m_slots.push_back({ 1, 0 });
+		} else {
+			index = m_free.back();
+			m_free.pop_back();
+		}
+
+		auto &slot = m_slots[index];
+		slot.dense = m_values.size();
+
+		const uint32_t handle = (slot.generation << INDEX_BITS) | index;
+
+		m_values.emplace_back(std::forward<Args>(args)...);
+		m_handles.push_back(handle);
+
+		return handle;
+	}
+	// returns false if the handle is stale
+	bool erase(uint32_t handle)
+	{
+		if (!find(handle)) {
+			return false;
+		}
+
+		auto &slot = m_slots[handle & INDEX_MASK];
+		const uint32_t last = m_values.size() - 1;
+		if (slot.dense != last) {
+			m_values[slot.dense] = std::move(m_values[last]);
+			m_handles[slot.dense] = m_handles[last];
+			m_slots[m_handles[last] & INDEX_MASK].dense = slot.dense;
+		}
+		m_values.pop_back();
+		m_handles.pop_back();
+
+		// old handles to this slot become stale
+		slot.generation = slot.generation == MAX_GENERATION ? 1 : slot.generation + 1;
+		m_free.push_back(handle & INDEX_MASK);
+
+		return true;
+	}
+	// returns nullptr if the handle is stale
+	T* find(uint32_t handle)
+	{
+		const uint32_t index = handle & INDEX_MASK;
+		if (index >= m_slots.size() || m_slots[index].generation != (handle >> INDEX_BITS)) {
+			return nullptr;
+		}
+
+		return &m_values[m_slots[index].dense];
+	}
+	const T* find(uint32_t handle) const
+	{
+		return const_cast<SlotMap<T>*>(this)->find(handle);
+	}
+	bool contains(uint32_t handle) const
+	{
+		return find(handle) != nullptr;
+	}
+	void clear()
+	{
+		m_values.clear();
+		m_handles.clear();
+		m_slots.clear();
+		m_free.clear();
+	}
+public:
+	size_t size() const { return m_values.size(); }
+	bool empty() const { return m_values.empty(); }
+	typename std::vector<T>::iterator begin() { return m_values.begin(); }
+	typename std::vector<T>::iterator end() { return m_values.end(); }
+	typename std::vector<T>::const_iterator begin() const { return m_values.begin(); }
+	typename std::vector<T>::const_iterator end() const { return m_values.end(); }
+public:
+	template <class Archive>
+	void serialize(Archive &archive)
+	{
+		archive(m_values, m_handles, m_slots, m_free);
+	}
+private:
+	struct Slot {
+		uint32_t generation = 1;
+		uint32_t dense = 0; // index in the values
+		template <class Archive>
+		void serialize(Archive &archive)
+		{
+			archive(generation, dense);
+		}
+	};
+	std::vector<T> m_values;
+	std::vector<uint32_t> m_handles; // handle of every value
+	std::vector<Slot> m_slots;
+	std::vector<uint32_t> m_free; // slots that can be reused
+};
+
+};
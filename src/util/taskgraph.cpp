@@ -0,0 +1,89 @@
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <functional>
+#include <future>
+#include <chrono>
+#include <stdexcept>
+
+#include "progress.h"
+#include "taskgraph.h"
+
+namespace util {
+
+TaskGraph::TaskID TaskGraph::add(const std::string &name, std::function<void()> job, const std::vector<TaskID> &dependencies)
+{
+	const TaskID id = m_tasks.size();
+
+	// only allow dependencies on earlier tasks so the graph can never contain a cycle
+	for (const auto &dependency : dependencies) {
+		if (dependency >= id) {
+			throw std::invalid_argument("task " + name + " depends on a task that does not exist yet");
+		}
+	}
+
+	Task task;
+	task.name = name;
+	task.job = job;
+	task.dependencies = dependencies;
+
+	m_tasks.push_back(task);
+
+	return id;
+}
+
+bool TaskGraph::run(Progress *progress)
+{
+	if (progress) {
+		progress->add_stages(m_tasks.size());
+	}
+
+	// tasks are already in topological order
+	// every task gets its own thread that first waits for the tasks it depends on
+	std::vector<std::shared_future<void>> futures;
+	futures.reserve(m_tasks.size());
+
+	for (auto &task : m_tasks) {
+		std::vector<std::shared_future<void>> prerequisites;
+		for (const auto &dependency : task.dependencies) {
+			prerequisites.push_back(futures[dependency]);
+		}
+
+		Task *current = &task;
+		auto future = std::async(std::launch::async, [current, prerequisites, progress]() {
+			for (const auto &prerequisite : prerequisites) {
+				prerequisite.get(); // rethrows if a dependency failed
+			}
+			current->milliseconds = 0.f;
+			if (progress && progress->cancelled()) {
+				return;
+			}
+			auto start = std::chrono::steady_clock::now();
+			current->job();
+			auto end = std::chrono::steady_clock::now();
+			current->milliseconds = float(std::chrono::duration<double, std::milli>(end - start).count());
+			if (progress) {
+				progress->finish_stage(current->name);
+			}
+		});
+
+		futures.push_back(future.share());
+	}
+
+	// wait for everything to finish, the first failure is passed on to the caller
+	for (auto &future : futures) {
+		future.wait();
+	}
+	for (auto &future : futures) {
+		future.get();
+	}
+
+	return !(progress && progress->cancelled());
+}
+
+void TaskGraph::clear()
+{
+	m_tasks.clear();
+}
+
+};
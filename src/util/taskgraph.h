@@ -0,0 +1,36 @@
+#pragma once
+
+namespace util {
+
+class Progress;
+
+// a set of jobs with declared dependencies
+// a job starts as soon as all the jobs it depends on have finished
+// so jobs without a dependency between them run concurrently
+class TaskGraph {
+public:
+	using TaskID = uint32_t;
+public:
+	// dependencies can only refer to tasks that were added before
+	TaskID add(const std::string &name, std::function<void()> job, const std::vector<TaskID> &dependencies = {});
+	// reports every finished task to the progress if there is one
+	// once the progress is cancelled tasks that have not started yet are skipped
+	// returns false if the run was cancelled
+	bool run(Progress *progress = nullptr);
+	void clear();
+public:
+	size_t size() const { return m_tasks.size(); }
+	const std::string& name(TaskID task) const { return m_tasks[task].name; }
+	// wall clock duration of the task in the last run
+	float milliseconds(TaskID task) const { return m_tasks[task].milliseconds; }
+private:
+	struct Task {
+		std::string name;
+		std::function<void()> job;
+		std::vector<TaskID> dependencies;
+		float milliseconds = 0.f;
+	};
+	std::vector<Task> m_tasks;
+};
+
+};
@@ -0,0 +1,223 @@
+#pragma once
+#include <atomic>
+#include <vector>
+#include <algorithm>
+
+namespace util {
+
+// image split up in square tiles that are only allocated once something is written to them
+// sampling a tile that was never written to returns zero
+// so sparse images such as the generation masks only use memory where something was drawn
+// tiles can be allocated from several threads at once
+template <class T>
+class TiledImage {
+public:
+	static const int TILE_SIZE = 256;
+public:
+	TiledImage() = default;
+	TiledImage(const TiledImage&) = delete;
+	TiledImage& operator=(const TiledImage&) = delete;
+	~TiledImage()
+	{
+		wipe();
+	}
+public:
+	void resize(int width, int height, uint8_t channels)
+	{
+		wipe();
+
+		m_width = width;
+		m_height = height;
+		m_channels = channels;
+		m_tiles_x = (width + TILE_SIZE - 1) / TILE_SIZE;
+		m_tiles_y = (height + TILE_SIZE - 1) / TILE_SIZE;
+
+		m_tiles = std::vector<std::atomic<T*>>(m_tiles_x * m_tiles_y);
+	}
+	// releases all tiles
+	void wipe()
+	{
+		for (auto &tile : m_tiles) {
+			delete [] tile.exchange(nullptr);
+		}
+	}
+	// exchanges the tiles of two images with the same size
+	void swap(TiledImage<T> &other)
+	{
+		for (size_t i = 0; i < m_tiles.size() && i < other.m_tiles.size(); i++) {
+			T *data = m_tiles[i].load();
+			m_tiles[i] = other.m_tiles[i].load();
+			other.m_tiles[i] = data;
+		}
+	}
+	void plot(int x, int y, uint8_t channel, T color)
+	{
+		if (channel >= m_channels) { return; }
+
+		if (x < 0 || y < 0 || x >= m_width || y >= m_height) { return; }
+
+		const int tile_x = x / TILE_SIZE;
+		const int tile_y = y / TILE_SIZE;
+
+		// writing zero to an empty tile changes nothing
+		if (color == T(0) && tile(tile_x, tile_y) == nullptr) { return; }
+
+		T *data = allocate_tile(tile_x, tile_y);
+		data[((y % TILE_SIZE) * TILE_SIZE + x % TILE_SIZE) * m_channels + channel] = color;
+	}
+	T sample(int x, int y, uint8_t channel) const
+	{
+		if (channel >= m_channels) { return 0; }
+
+		if (x < 0 || y < 0 || x >= m_width || y >= m_height) { return 0; }
+
+		const T *data = tile(x / TILE_SIZE, y / TILE_SIZE);
+		if (data == nullptr) { return 0; }
+
+		return data[((y % TILE_SIZE) * TILE_SIZE + x % TILE_SIZE) * m_channels + channel];
+	}
+	T sample_relative(float x, float y, uint8_t channel) const
+	{
+		return sample(x * m_width, y * m_height, channel);
+	}
+public:
+	// tile data, nullptr if nothing has been written to the tile
+	const T* tile(int tile_x, int tile_y) const
+	{
+		return m_tiles[tile_y * m_tiles_x + tile_x].load(std::memory_order_acquire);
+	}
+	T* allocate_tile(int tile_x, int tile_y)
+	{
+		auto &slot = m_tiles[tile_y * m_tiles_x + tile_x];
+		T *data = slot.load(std::memory_order_acquire);
+		if (data == nullptr) {
+			T *fresh = new T[TILE_SIZE * TILE_SIZE * m_channels]();
+			if (slot.compare_exchange_strong(data, fresh, std::memory_order_acq_rel)) {
+				data = fresh;
+			} else {
+				delete [] fresh; // another thread was first
+			}
+		}
+
+		return data;
+	}
+	// visits every pixel of the allocated tiles in parallel, tile by tile
+	// pixels in tiles that were never written to are zero and skipped
+	template <typename Visitor>
+	void for_each_pixel(uint8_t channel, Visitor visitor) const
+	{
+		if (channel >= m_channels) { return; }
+
+		const int count = m_tiles.size();
+
+		#pragma omp parallel for schedule(dynamic)
+		for (int i = 0; i < count; i++) {
+			const T *data = m_tiles[i].load(std::memory_order_acquire);
+			if (data == nullptr) {
+				continue;
+			}
+			const int x0 = (i % m_tiles_x) * TILE_SIZE;
+			const int y0 = (i / m_tiles_x) * TILE_SIZE;
+			const int x1 = std::min(x0 + TILE_SIZE, m_width);
+			const int y1 = std::min(y0 + TILE_SIZE, m_height);
+			for (int y = y0; y < y1; y++) {
+				const T *row = data + (y - y0) * TILE_SIZE * m_channels;
+				for (int x = x0; x < x1; x++) {
+					visitor(x, y, row[(x - x0) * m_channels + channel]);
+				}
+			}
+		}
+	}
+	// copies a rectangle into a dense buffer, parts outside the image or in empty tiles become zero
+	void read_region(int x, int y, int width, int height, T *output) const
+	{
+		for (int row = 0; row < height; row++) {
+			T *destination = output + row * width * m_channels;
+			for (int column = 0; column < width; ) {
+				const int px = x + column;
+				const int py = y + row;
+				// pixels up to the next tile edge share the same tile row
+				const int span = std::min(width - column, TILE_SIZE - ((px % TILE_SIZE) + TILE_SIZE) % TILE_SIZE);
+				const T *data = nullptr;
+				if (px >= 0 && py >= 0 && px < m_width && py < m_height) {
+					data = tile(px / TILE_SIZE, py / TILE_SIZE);
+				}
+				if (data) {
+					const T *source = data + ((py % TILE_SIZE) * TILE_SIZE + px % TILE_SIZE) * m_channels;
+					std::copy(source, source + span * m_channels, destination + column * m_channels);
+				} else {
+					std::fill(destination + column * m_channels, destination + (column + span) * m_channels, T(0));
+				}
+				column += span;
+			}
+		}
+	}
+public: // rasterize methods
+	void draw_filled_circle(int x0, int y0, int radius, uint8_t channel, T color)
+	{
+		int x = radius;
+		int y = 0;
+		int xchange = 1 - (radius << 1);
+		int ychange = 0;
+		int err = 0;
+
+		while (x >= y) {
+			for (int i = x0 - x; i <= x0 + x; i++) {
+				plot(i, y0 + y, channel, color);
+				plot(i, y0 - y, channel, color);
+			}
+			for (int i = x0 - y; i <= x0 + y; i++) {
+				plot(i, y0 + x, channel, color);
+				plot(i, y0 - x, channel, color);
+			}
+
+			y++;
+			err += ychange;
+			ychange += 2;
+			if (((err << 1) + xchange) > 0) {
+				x--;
+				err += xchange;
+				xchange += 2;
+			}
+		}
+	}
+	void draw_thick_line(int x0, int y0, int x1, int y1, int radius, uint8_t channel, T color)
+	{
+		int dx =  abs(x1 - x0), sx = x0 < x1 ? 1 : -1;
+		int dy = -abs(y1 - y0), sy = y0 < y1 ? 1 : -1;
+		int err = dx + dy, e2; // error value e_xy
+
+		for (;;) {
+			draw_filled_circle(x0, y0, radius, channel, color);
+			if (x0 == x1 && y0 == y1) { break; }
+			e2 = 2 * err;
+			if (e2 >= dy) { err += dy; x0 += sx; } // e_xy+e_x > 0
+			if (e2 <= dx) { err += dx; y0 += sy; } // e_xy+e_y < 0
+		}
+	}
+	void draw_thick_line_relative(const glm::vec2 &a, const glm::vec2 &b, int radius, uint8_t channel, T color)
+	{
+		draw_thick_line(a.x * m_width, a.y * m_height, b.x * m_width, b.y * m_height, radius, channel, color);
+	}
+public:
+	void blur(float sigma);
+public:
+	uint8_t channels() const { return m_channels; }
+	int width() const { return m_width; }
+	int height() const { return m_height; }
+	int tiles_x() const { return m_tiles_x; }
+	int tiles_y() const { return m_tiles_y; }
+	size_t allocated_tiles() const
+	{
+		return std::count_if(m_tiles.begin(), m_tiles.end(), [](const std::atomic<T*> &tile) { return tile.load() != nullptr; });
+	}
+private:
+	uint8_t m_channels = 0;
+	int m_width = 0;
+	int m_height = 0;
+	int m_tiles_x = 0;
+	int m_tiles_y = 0;
+	std::vector<std::atomic<T*>> m_tiles;
+};
+
+};